@@ -0,0 +1,389 @@
+// ghh_json.h benchmarks, see the Makefile. usage:
+//
+//     bench [-t seconds] file...
+//
+// .json files are timed for parsing, serializing, json_copy() and looking up
+// every key, .ndjson files for json_lines_load(). each is repeated for at
+// least -t seconds (default 0.5) and the fastest run is reported, followed by
+// the json_stats_t of one run and the allocator calls it made
+
+// clock_gettime()
+#define _POSIX_C_SOURCE 199309L
+
+#define GHH_JSON_IMPL
+#include "../ghh_json.h"
+
+#include <time.h>
+
+static double min_seconds = 0.5;
+
+// timing ======================================================================
+
+static double bench_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+typedef void (*bench_fn_t)(void *arg);
+
+// fastest of at least 3 runs of fn spanning min_seconds
+static double bench_time(bench_fn_t fn, void *arg) {
+    double best = 1e30, total = 0;
+
+    for (int runs = 0; runs < 3 || total < min_seconds; ++runs) {
+        double start = bench_now();
+
+        fn(arg);
+
+        double elapsed = bench_now() - start;
+
+        total += elapsed;
+
+        if (elapsed < best)
+            best = elapsed;
+    }
+
+    return best;
+}
+
+// counting allocator ==========================================================
+
+typedef struct bench_counts {
+    size_t allocs, resizes, releases;
+} bench_counts_t;
+
+static void *bench_alloc(void *user, size_t size) {
+    ++((bench_counts_t *)user)->allocs;
+
+    return malloc(size);
+}
+
+static void *bench_resize(void *user, void *ptr, size_t old_size, size_t size) {
+    (void)old_size;
+    ++((bench_counts_t *)user)->resizes;
+
+    return realloc(ptr, size);
+}
+
+static void bench_release(void *user, void *ptr, size_t size) {
+    (void)size;
+    ++((bench_counts_t *)user)->releases;
+
+    free(ptr);
+}
+
+static bench_counts_t counts;
+static const json_allocator_t counting = {
+    bench_alloc,
+    bench_resize,
+    bench_release,
+    &counts
+};
+
+// reporting ===================================================================
+
+static void print_rate(const char *name, size_t bytes, double seconds) {
+    printf("  %-12s %9.1f MB/s\n", name, (double)bytes / seconds / 1e6);
+}
+
+static void print_stats(const json_stats_t *stats, double docs) {
+    printf(
+        "    pages %.1f (%.1f KB), used %.1f KB, tracked %.1f (%.1f KB), "
+        "rehashes %.1f, max probe %zu\n",
+        (double)stats->pages / docs,
+        (double)stats->page_bytes / docs / 1e3,
+        (double)stats->used / docs / 1e3,
+        (double)stats->tracked / docs,
+        (double)stats->tracked_bytes / docs / 1e3,
+        (double)stats->rehashes / docs,
+        stats->max_probe
+    );
+}
+
+// prints what the allocator was asked for since the last call
+static void print_counts(void) {
+    printf(
+        "    allocator: %zu allocs, %zu resizes, %zu releases\n",
+        counts.allocs,
+        counts.resizes,
+        counts.releases
+    );
+
+    memset(&counts, 0, sizeof(counts));
+}
+
+// documents ===================================================================
+
+typedef struct bench_doc {
+    char *text;
+    size_t len;
+
+    json_t json, dst;
+    char *out;
+    size_t out_len;
+
+    // keys copied out of the document, so lookups can't match by pointer
+    json_object_t **objects;
+    char **keys;
+    size_t key_count, key_cap;
+} bench_doc_t;
+
+// a fresh json_t per document
+static void run_parse(void *arg) {
+    bench_doc_t *doc = (bench_doc_t *)arg;
+    json_t json;
+
+    json_load_empty_alloc(&json, &counting);
+    json_load_ex(&json, doc->text, doc->len, JSON_LOAD_REUSE);
+    json_unload(&json);
+}
+
+// one json_t reused for every document
+static void run_parse_reuse(void *arg) {
+    bench_doc_t *doc = (bench_doc_t *)arg;
+
+    json_load_ex(&doc->json, doc->text, doc->len, JSON_LOAD_REUSE);
+}
+
+static void run_serialize(void *arg) {
+    bench_doc_t *doc = (bench_doc_t *)arg;
+
+    json_serialize_into(doc->out, doc->out_len + 1, doc->json.root, true, 0);
+}
+
+static void run_copy(void *arg) {
+    bench_doc_t *doc = (bench_doc_t *)arg;
+
+    json_reset(&doc->dst);
+    json_copy(&doc->dst, doc->json.root);
+}
+
+static void run_lookups(void *arg) {
+    bench_doc_t *doc = (bench_doc_t *)arg;
+
+    for (size_t i = 0; i < doc->key_count; ++i)
+        if (!json_get_object(doc->objects[i], doc->keys[i]))
+            abort();
+}
+
+static void collect_keys(bench_doc_t *doc, json_object_t *object) {
+    if (object->type == JSON_ARRAY) {
+        size_t size;
+        json_object_t **children = json_to_array(object, &size);
+
+        for (size_t i = 0; i < size; ++i)
+            collect_keys(doc, children[i]);
+    } else if (object->type == JSON_OBJECT) {
+        size_t size;
+        char **keys = json_get_keys(object, &size);
+
+        for (size_t i = 0; i < size; ++i) {
+            if (doc->key_count == doc->key_cap) {
+                doc->key_cap = doc->key_cap ? doc->key_cap * 2 : 1024;
+                doc->objects = (json_object_t **)realloc(
+                    doc->objects,
+                    doc->key_cap * sizeof(*doc->objects)
+                );
+                doc->keys = (char **)realloc(
+                    doc->keys,
+                    doc->key_cap * sizeof(*doc->keys)
+                );
+            }
+
+            size_t len = strlen(keys[i]);
+
+            doc->objects[doc->key_count] = object;
+            doc->keys[doc->key_count] = (char *)memcpy(
+                malloc(len + 1),
+                keys[i],
+                len + 1
+            );
+            ++doc->key_count;
+
+            collect_keys(doc, json_get_object(object, keys[i]));
+        }
+    }
+}
+
+static void bench_json(char *text, size_t len) {
+    bench_doc_t doc;
+
+    memset(&doc, 0, sizeof(doc));
+    doc.text = text;
+    doc.len = len;
+
+    // stats and allocator calls are from one run after the timed ones
+    print_rate("parse", len, bench_time(run_parse, &doc));
+
+    memset(&counts, 0, sizeof(counts));
+    json_load_empty_alloc(&doc.json, &counting);
+    json_load_ex(&doc.json, text, len, JSON_LOAD_REUSE);
+
+    print_stats(&doc.json.stats, 1);
+    print_counts();
+
+    print_rate("parse reuse", len, bench_time(run_parse_reuse, &doc));
+
+    memset(&counts, 0, sizeof(counts));
+    run_parse_reuse(&doc);
+
+    print_stats(&doc.json.stats, 1);
+    print_counts();
+
+    doc.out_len = json_serialized_size(doc.json.root, true, 0);
+    doc.out = (char *)malloc(doc.out_len + 1);
+
+    print_rate("serialize", doc.out_len, bench_time(run_serialize, &doc));
+
+    json_load_empty_alloc(&doc.dst, &counting);
+
+    print_rate("copy", len, bench_time(run_copy, &doc));
+
+    memset(&counts, 0, sizeof(counts));
+    run_copy(&doc);
+
+    print_stats(&doc.dst.stats, 1);
+    print_counts();
+
+    collect_keys(&doc, doc.json.root);
+
+    if (doc.key_count) {
+        double seconds = bench_time(run_lookups, &doc);
+
+        printf(
+            "  %-12s %9.1f M/s (%zu keys)\n",
+            "lookups",
+            (double)doc.key_count / seconds / 1e6,
+            doc.key_count
+        );
+    }
+
+    for (size_t i = 0; i < doc.key_count; ++i)
+        free(doc.keys[i]);
+
+    free(doc.keys);
+    free(doc.objects);
+    free(doc.out);
+    json_unload(&doc.json);
+    json_unload(&doc.dst);
+}
+
+// json lines ==================================================================
+
+typedef struct bench_lines {
+    char *text;
+    size_t len;
+} bench_lines_t;
+
+static void run_lines(void *arg) {
+    bench_lines_t *lines = (bench_lines_t *)arg;
+    json_lines_t loaded;
+
+    json_lines_load(&loaded, lines->text, lines->len, 0, 1);
+    json_lines_unload(&loaded);
+}
+
+static void bench_lines(char *text, size_t len) {
+    bench_lines_t lines = {text, len};
+    json_lines_t loaded;
+    json_stats_t stats;
+
+    print_rate("lines", len, bench_time(run_lines, &lines));
+
+    // stats are per worker context, summed for the whole file
+    json_lines_load(&loaded, text, len, 0, 1);
+    memset(&stats, 0, sizeof(stats));
+
+    for (size_t i = 0; i < loaded.context_count; ++i) {
+        const json_stats_t *worker = &loaded.contexts[i].stats;
+
+        stats.pages += worker->pages;
+        stats.page_bytes += worker->page_bytes;
+        stats.used += worker->used;
+        stats.tracked += worker->tracked;
+        stats.tracked_bytes += worker->tracked_bytes;
+        stats.rehashes += worker->rehashes;
+
+        if (worker->max_probe > stats.max_probe)
+            stats.max_probe = worker->max_probe;
+    }
+
+    printf("    %zu documents, per document:\n", loaded.count);
+    print_stats(&stats, loaded.count ? (double)loaded.count : 1);
+
+    json_lines_unload(&loaded);
+}
+
+// main ========================================================================
+
+static char *read_file(const char *path, size_t *out_len) {
+    FILE *file = fopen(path, "rb");
+
+    if (!file)
+        return NULL;
+
+    fseek(file, 0, SEEK_END);
+
+    long len = ftell(file);
+    char *text = (char *)malloc((size_t)len + 1);
+
+    fseek(file, 0, SEEK_SET);
+
+    if (fread(text, 1, (size_t)len, file) != (size_t)len) {
+        free(text);
+        fclose(file);
+
+        return NULL;
+    }
+
+    fclose(file);
+    text[len] = '\0';
+    *out_len = (size_t)len;
+
+    return text;
+}
+
+static bool ends_with(const char *str, const char *suffix) {
+    size_t len = strlen(str), suffix_len = strlen(suffix);
+
+    return len >= suffix_len && !strcmp(str + len - suffix_len, suffix);
+}
+
+int main(int argc, char **argv) {
+    int status = 0;
+
+#ifndef JSON_STATS
+    printf("built without JSON_STATS, stats will be 0\n");
+#endif
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            min_seconds = atof(argv[++i]);
+            continue;
+        }
+
+        size_t len;
+        char *text = read_file(argv[i], &len);
+
+        if (!text) {
+            fprintf(stderr, "couldn't read %s\n", argv[i]);
+            status = 1;
+
+            continue;
+        }
+
+        printf("%s (%.2f MB)\n", argv[i], (double)len / 1e6);
+
+        if (ends_with(argv[i], ".ndjson"))
+            bench_lines(text, len);
+        else
+            bench_json(text, len);
+
+        free(text);
+    }
+
+    return status;
+}
@@ -10,6 +10,7 @@ extern "C" {
 #include <stddef.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef enum json_type {
     JSON_OBJECT,
@@ -25,32 +26,313 @@ typedef struct json_object {
     union json_obj_data {
         struct json_hmap *hmap;
         struct json_vec *vec;
+        struct json_span *span; // see is_lazy
         char *string;
         double number;
+        int64_t integer;
     } data;
 
     json_type_e type;
+    bool is_int; // JSON_NUMBER is stored in data.integer rather than data.number
+    // JSON_OBJECT or JSON_ARRAY from a JSON_LOAD_LAZY load which hasn't been
+    // accessed yet, it's parsed by the first get/to/put/pop call on it
+    bool is_lazy;
+    // is_lazy comes from json_image_load() rather than text, its block's
+    // pointers are fixed up on first access instead of parsed
+    bool is_image;
 } json_object_t;
 
+// object keys are hashed with fnv-1a
+#if INTPTR_MAX == INT64_MAX
+// 64 bit
+typedef uint64_t json_hash_t;
+#define JSON_FNV_PRIME 0x00000100000001b3
+#define JSON_FNV_BASIS 0xcbf29ce484222325
+#else
+// 32 bit
+typedef uint32_t json_hash_t;
+#define JSON_FNV_PRIME 0x01000193
+#define JSON_FNV_BASIS 0x811c9dc5
+#endif
+
+// memory interface for a json_t, the default one uses JSON_MALLOC and
+// JSON_FREE. sizes are passed back to resize and release so pools don't need
+// headers of their own
+typedef struct json_allocator {
+    void *(*alloc)(void *user, size_t size);
+    // like realloc(), ptr is never NULL
+    void *(*resize)(void *user, void *ptr, size_t old_size, size_t new_size);
+    void (*release)(void *user, void *ptr, size_t size);
+    void *user;
+} json_allocator_t;
+
+// fixed buffer backend for json_bump_allocator(). it never calls JSON_MALLOC,
+// running out of space is an error. memory is only given back when the most
+// recent allocation is released, set used to 0 to reuse the buffer once every
+// json_t using it is unloaded
+typedef struct json_bump {
+    char *buf;
+    size_t size, used;
+} json_bump_t;
+
+// allocator and hashmap counters of a json_t since it was made or last reset,
+// only counted when compiled with JSON_STATS
+typedef struct json_stats {
+    size_t pages, page_bytes; // pages allocated and their total size
+    size_t used; // bytes handed out from pages
+    size_t tracked, tracked_bytes; // tracked allocations and their total size
+    size_t rehashes; // hashmap indexes built or rebuilt
+    size_t max_probe; // most slots an index insert had to probe
+} json_stats_t;
+
 typedef struct json {
     json_object_t *root;
 
     // allocators
+    json_allocator_t allocator;
     struct json_tptr **tracked; // fat pointer array of tracked pointers
-    char **pages; // fat pointer
+    char **pages; // fat pointer array of fat pointer pages
     size_t cur_tracked, tracked_cap; // tracks tracked pointers
-    size_t cur_page, page_cap; // tracks allocator pages
-    size_t used; // tracks current page stack
+    size_t cur_page, page_count, page_cap; // tracks allocator pages
+    size_t used, page_size; // tracks current page stack
+    size_t grow_size; // size of the next new page
+
+    // parser's scratch stack, kept with the pages by json_reset()
+    char *scratch;
+    size_t scratch_cap;
+
+    // strings shared by JSON_LOAD_INTERN loads and json_intern(), an open
+    // addressed table of page strings
+    struct json_intern *interns;
+    size_t intern_count, intern_cap; // intern_cap is 0 or a power of 2
+
+    // set by json_freeze(), nothing may be allocated or modified until the
+    // next load or reset
+    bool frozen;
+
+    // source file held by json_load_mapped(), released on unload. this is not
+    // NUL terminated
+    char *file_text;
+    size_t file_len;
+    bool file_mapped;
+
+    // all 0 without JSON_STATS
+    json_stats_t stats;
 } json_t;
 
+// flags for json_load_ex() and json_load_mapped(), combine with |
+typedef enum json_load_flags {
+    // decode strings in place and NUL terminate them inside the text instead
+    // of copying them to the json_t. text must be mutable and outlive the json_t
+    JSON_LOAD_INSITU = 0x1,
+    // json_t is already loaded, json_reset() it and keep its memory rather
+    // than making a new context
+    JSON_LOAD_REUSE = 0x2,
+    // split the root's children between one worker per cpu, which each parse
+    // into pages that the json_t takes over. needs JSON_THREADS, and the json_t
+    // must use the default allocator, otherwise this is a normal load
+    JSON_LOAD_PARALLEL = 0x4,
+    // only find where containers end, each one is parsed the first time it's
+    // accessed. text must stay unchanged until json_unload(). JSON_MAX_DEPTH is
+    // checked by the load, other errors inside a container are reported once
+    // it's accessed. reads can parse, so they mustn't happen on several threads
+    // at once. unparsed containers point at the json_t they parse onto, so it
+    // mustn't be moved or copied to another address until json_freeze() has
+    // parsed them. ignores JSON_LOAD_PARALLEL
+    JSON_LOAD_LAZY = 0x8,
+    // keys, and strings of up to JSON_INTERN_MAX_LEN bytes, are stored once per
+    // json_t and shared by every object using them. shared strings mustn't be
+    // modified in place. ignored with JSON_LOAD_INSITU
+    JSON_LOAD_INTERN = 0x10
+} json_load_flags_e;
+
 void json_load(json_t *, char *text);
+// load json from a buffer of len bytes, which doesn't need to be terminated
+void json_load_n(json_t *, const char *text, size_t len);
+void json_load_ex(json_t *, char *text, size_t len, unsigned flags);
+
+#define JSON_ERROR_MESSAGE_LEN 64
+
+typedef enum json_error_code {
+    JSON_ERR_NONE,
+    JSON_ERR_SYNTAX,
+    JSON_ERR_DEPTH // containers nested deeper than JSON_MAX_DEPTH
+} json_error_e;
+
+// where and why a json_try_load() failed
+typedef struct json_error {
+    json_error_e code;
+    size_t offset; // of the byte the error was found at
+    char message[JSON_ERROR_MESSAGE_LEN];
+} json_error_t;
+
+// json_load_ex() which reports malformed text instead of exiting. on failure
+// error is filled in and json is left reset with a NULL root, ready for a
+// JSON_LOAD_REUSE load. error may be NULL. json must be unloaded either way.
+// ignores JSON_LOAD_PARALLEL and JSON_LOAD_LAZY, errors past the text (out of
+// memory, misuse) still exit
+bool json_try_load(
+    json_t *, char *text, size_t len, unsigned flags, json_error_t *error
+);
+// checks that text would load without loading it, nothing is allocated.
+// error may be NULL
+bool json_validate(const char *text, size_t len, json_error_t *error);
+// finds the line and column of an error offset, both counting from 1. this
+// scans text up to offset, so it's only done when asked for
+void json_error_position(
+    const char *text, size_t offset, size_t *out_line, size_t *out_column
+);
 void json_load_empty(json_t *);
+// json_load_empty() with an allocator for all of the json_t's memory. load into
+// it with JSON_LOAD_REUSE
+void json_load_empty_alloc(json_t *, const json_allocator_t *);
+// returns an allocator using size bytes of buf, bump is its state
+json_allocator_t json_bump_allocator(json_bump_t *bump, void *buf, size_t size);
+// drops everything in a json_t but keeps its pages for the next load
+void json_reset(json_t *);
+// makes sure the json_t can allocate size bytes without allocating more pages,
+// loading calls this with an estimate from the length of the text
+void json_reserve(json_t *, size_t size);
+// maps the file where possible, otherwise reads it in a single pass
 void json_load_file(json_t *, const char *filepath);
+// json_load_file() but the file text stays available in json->file_text until
+// json_unload(). with JSON_LOAD_INSITU the mapping is a private copy-on-write
+// one, so strings point into it and the file itself isn't modified
+void json_load_mapped(json_t *, const char *filepath, unsigned flags);
 void json_unload(json_t *);
 
+// newline delimited json (ndjson, json lines), one document per line. lines are
+// split between workers which each parse into their own json_t
+typedef struct json_lines {
+    json_object_t **roots; // one per non-blank line, in order
+    size_t count;
+
+    // worker contexts, the roots live on these until json_lines_unload()
+    json_t *contexts;
+    size_t context_count;
+    size_t roots_cap;
+
+    // source file held by json_lines_load_file() for JSON_LOAD_INSITU or
+    // JSON_LOAD_LAZY
+    char *file_text;
+    size_t file_len;
+    bool file_mapped;
+} json_lines_t;
+
+// parses len bytes of lines on up to threads workers, 0 uses one per cpu.
+// flags are json_load_flags_e. without JSON_THREADS this parses on the calling
+// thread
+void json_lines_load(
+    json_lines_t *, char *text, size_t len, unsigned flags, unsigned threads
+);
+void json_lines_load_file(
+    json_lines_t *, const char *filepath, unsigned flags, unsigned threads
+);
+void json_lines_unload(json_lines_t *);
+
+// event callbacks for json_sax_parse(), any of them may be NULL. strings are
+// NUL terminated and only valid during the call. returning false stops the
+// parse
+typedef struct json_sax {
+    bool (*start_object)(void *user);
+    bool (*end_object)(void *user);
+    bool (*start_array)(void *user);
+    bool (*end_array)(void *user);
+    bool (*key)(void *user, const char *key, size_t len);
+    bool (*string)(void *user, const char *string, size_t len);
+    bool (*number)(void *user, double number);
+    // integers which fit in an int64_t, these go to number when this is NULL
+    bool (*integer)(void *user, int64_t integer);
+    bool (*boolean)(void *user, bool value);
+    bool (*null)(void *user);
+
+    void *user;
+    const json_allocator_t *allocator; // NULL for the default
+} json_sax_t;
+
+// parses text into callbacks without building any objects, memory used is
+// bounded by nesting depth and string length. returns false if a callback
+// stopped the parse
+bool json_sax_parse(const json_sax_t *, const char *text, size_t len);
+bool json_sax_parse_file(const json_sax_t *, const char *filepath);
+
+// push parser state, text can be fed to it in chunks split at any byte. all
+// fields are internal
+typedef struct json_parser {
+    json_sax_t sax;
+    json_allocator_t allocator;
+    int state;
+    bool stopped;
+    bool last; // the text being fed is the rest of the document
+
+    // open containers, one '{' or '[' per level. strings being reported to
+    // callbacks are decoded above the top
+    char *stack;
+    size_t depth, stack_cap;
+
+    // token cut off by the end of a chunk
+    char *token;
+    size_t token_len, token_cap;
+    char token_kind;
+    bool token_escape;
+
+    // json_parser_make_dom() state, pending children of open containers
+    json_t *json;
+    char *build;
+    size_t build_size, build_cap, build_frame;
+    char *key;
+    size_t key_len;
+    bool intern;
+} json_parser_t;
+
+// starts a push parser which calls sax for each event
+void json_parser_make(json_parser_t *, const json_sax_t *sax);
+// starts a push parser which loads into json, flags are json_load_flags_e
+// except for JSON_LOAD_INSITU
+void json_parser_make_dom(json_parser_t *, json_t *json, unsigned flags);
+// parses the next len bytes. returns false once a callback has stopped the
+// parse
+bool json_parser_feed(json_parser_t *, const char *buf, size_t len);
+// ends the text and frees the parser, the text must be a complete document
+// unless the parse was stopped. returns false if it was
+bool json_parser_finish(json_parser_t *);
+
 // returns a string allocated with JSON_MALLOC
 // TODO make this a lot easier
 char *json_serialize(json_object_t *, bool mini, int indent, size_t *out_len);
+// json_serialize() using allocator for its buffers and the returned string.
+// release the string with a size of *out_len + 1
+char *json_serialize_alloc(
+    json_object_t *, bool mini, int indent, size_t *out_len,
+    const json_allocator_t *allocator
+);
+
+// the exact length json_serialize() would return in *out_len
+size_t json_serialized_size(json_object_t *, bool mini, int indent);
+// json_serialize() into buf, only allocating for json nested over 32 levels
+// deep. like snprintf() this returns the length of the whole text, which only
+// fit (with its terminator) if it's less than cap. otherwise buf is left as an
+// empty string
+size_t json_serialize_into(
+    char *buf, size_t cap, json_object_t *, bool mini, int indent
+);
+
+// somewhere for json_serialize_to() to write, write returns false on failure
+typedef struct json_sink {
+    bool (*write)(void *user, const char *data, size_t len);
+    void *user;
+} json_sink_t;
+
+// json_serialize() in chunks of up to JSON_SINK_BUF_SIZE bytes, so the first
+// ones go out before the rest is serialized. returns false if a write failed
+bool json_serialize_to(
+    json_object_t *, bool mini, int indent, const json_sink_t *sink
+);
+json_sink_t json_file_sink(FILE *file);
+#if defined(__unix__) || defined(__APPLE__)
+// writes to a file descriptor, retrying partial writes
+json_sink_t json_fd_sink(int fd);
+#endif
 
 // take an object, retrieve data and cast
 json_object_t *json_get_object(json_object_t *, char *key);
@@ -58,6 +340,7 @@ json_object_t *json_get_object(json_object_t *, char *key);
 json_object_t **json_get_array(json_object_t *, char *key, size_t *out_size);
 char *json_get_string(json_object_t *, char *key);
 double json_get_number(json_object_t *, char *key);
+int64_t json_get_int64(json_object_t *, char *key);
 bool json_get_bool(json_object_t *, char *key);
 
 // returns actual, mutable array pointer. do not modify.
@@ -67,6 +350,8 @@ char **json_get_keys(json_object_t *, size_t *out_size);
 json_object_t **json_to_array(json_object_t *, size_t *out_size);
 char *json_to_string(json_object_t *);
 double json_to_number(json_object_t *);
+// integers are exact, other numbers are truncated
+int64_t json_to_int64(json_object_t *);
 bool json_to_bool(json_object_t *);
 
 // remove a json_object from another json_object (unordered)
@@ -86,6 +371,7 @@ void json_put_array(
 );
 void json_put_string(json_t *, json_object_t *, char *key, char *string);
 void json_put_number(json_t *, json_object_t *, char *key, double number);
+void json_put_int64(json_t *, json_object_t *, char *key, int64_t integer);
 void json_put_bool(json_t *, json_object_t *, char *key, bool value);
 void json_put_null(json_t *, json_object_t *, char *key);
 
@@ -94,17 +380,210 @@ json_object_t *json_new_object(json_t *);
 json_object_t *json_new_array(json_t *, json_object_t **objects, size_t size);
 json_object_t *json_new_string(json_t *, char *string);
 json_object_t *json_new_number(json_t *, double number);
+json_object_t *json_new_int64(json_t *, int64_t integer);
 json_object_t *json_new_bool(json_t *, bool value);
 json_object_t *json_new_null(json_t *);
 
 // allocate and recursively copy an object and its children
 json_object_t *json_copy(json_t *, json_object_t *);
 
+// reading a json_t never writes to it once it's frozen, so any number of
+// threads can read one at the same time without locking. freezing parses
+// every lazy container and fixes up every image block under the root, after
+// which modifying the json_t is an error until it's reset or unloaded. other
+// threads need to be handed the json_t after json_freeze() returns, through
+// whatever synchronization starts them or passes them work
+void json_freeze(json_t *);
+// building can be split between threads by giving each one its own json_t to
+// make objects on. json_absorb() moves everything allocated on src over to
+// json and leaves src unloaded, so its objects can be put into json's tree.
+// both must use the same allocator, and src can't hold a file from
+// json_load_mapped(). only one thread may absorb into a json_t at a time
+void json_absorb(json_t *json, json_t *src);
+// json_absorb() src, then json_put() its root into object under key. returns
+// the grafted root
+json_object_t *json_graft(
+    json_t *json, json_object_t *object, char *key, json_t *src
+);
+
+// an object key hashed ahead of time, str must outlive it. in c++ json_key()
+// makes these from literals at compile time
+typedef struct json_key {
+    const char *str;
+    size_t len;
+    json_hash_t hash;
+} json_key_t;
+
+json_key_t json_key_make(const char *str);
+// returns the json_t's shared copy of str, the same one JSON_LOAD_INTERN loads
+// use. keys put with it aren't copied again, and match by pointer
+char *json_intern(json_t *, const char *str);
+// json_get_object() without hashing key
+json_object_t *json_key_get(json_object_t *, const json_key_t *key);
+
+// a compiled json pointer (rfc 6901), each step is an object key or an array
+// index. index is SIZE_MAX for keys that can't index an array
+typedef struct json_path_step {
+    json_key_t key;
+    size_t index;
+} json_path_step_t;
+
+typedef struct json_path {
+    json_path_step_t *steps; // the unescaped keys are stored after the steps
+    size_t count;
+} json_path_t;
+
+// compiles a pointer like "/a/b~1c/0", "" is the whole document
+void json_path_make(json_path_t *, const char *pointer);
+void json_path_free(json_path_t *);
+// returns the object path points to under root, or NULL if there isn't one
+json_object_t *json_path_get(json_object_t *root, const json_path_t *);
+
+// the c type a json_field_t is stored as
+typedef enum json_field_type {
+    JSON_FIELD_BOOL, // bool
+    JSON_FIELD_INT, // int
+    JSON_FIELD_INT64, // int64_t
+    JSON_FIELD_DOUBLE, // double
+    JSON_FIELD_STRING, // char *, NULL for json null
+    JSON_FIELD_STRUCT, // struct with the fields of schema
+    // pointer to elements of type elem (of schema for JSON_FIELD_STRUCT), with
+    // their count in the size_t at count_offset. NULL for json null, and never
+    // NULL for an empty array
+    JSON_FIELD_ARRAY
+} json_field_type_e;
+
+// describes a struct member and the object member with the same name, e.g.
+// {"age", JSON_FIELD_INT, offsetof(struct person, age)}
+typedef struct json_field {
+    const char *name;
+    json_field_type_e type;
+    size_t offset;
+    const struct json_schema *schema;
+    json_field_type_e elem;
+    size_t count_offset;
+} json_field_t;
+
+typedef struct json_schema {
+    const json_field_t *fields;
+    size_t count;
+    size_t size; // sizeof the struct, for arrays of it
+} json_schema_t;
+
+// parses an object straight into the struct at out without building any
+// objects. members which aren't in schema are skipped, and fields without a
+// member keep their value. strings and arrays are allocated on the json_t,
+// which is loaded like json_load_ex() with JSON_LOAD_INSITU or JSON_LOAD_REUSE
+// but keeps no root
+void json_decode(
+    json_t *, const json_schema_t *, void *out, char *text, size_t len,
+    unsigned flags
+);
+// serializes the struct at in like json_serialize(), fields in schema order
+char *json_encode(
+    const json_schema_t *, const void *in, bool mini, int indent,
+    size_t *out_len
+);
+
+// binary images hold a document in the same layout as a loaded json_t, with
+// its maps already indexed. pointers are stored as offsets and each container
+// is fixed up the first time it's accessed, like a JSON_LOAD_LAZY load, so
+// loading only touches the header and there's nothing to parse or hash.
+// images only load on machines with the same pointer size and byte order as
+// the one saving them, and beyond their header they're trusted like memory
+//
+// returns an image of the tree under root allocated with JSON_MALLOC
+char *json_image_make(json_object_t *root, size_t *out_len);
+// writes json_image_make() to sink, returns false if a write failed
+bool json_image_save(json_object_t *root, const json_sink_t *sink);
+// loads an image in place, image must be mutable, aligned to 8 bytes and
+// outlive the json_t. an image buffer can only be loaded once
+void json_image_load(json_t *, char *image, size_t len);
+// maps the image file as a private copy, it's released by json_unload()
+void json_image_load_file(json_t *, const char *filepath);
+
+// tapes are a read-only layout of a document as one array of 64 bit words in
+// document order, with every child reached by offset rather than pointer.
+// each word is an 8 bit tag and a 56 bit payload:
+//
+// '{' '['  payload is the index of the word after the matching close
+// '}' ']'  payload is the number of members or elements
+// '"'      payload is the offset of the string in strings, which is preceded
+//          by its length as a uint64_t. object members are a '"' key word and
+//          then the value
+// 'l' 'd'  the next word holds an int64_t or a double
+// 't' 'f' 'n'
+//
+// the root is at words[0]. tapes don't point into memory they don't own, so
+// a copy of words and strings is a copy of the tape. json_tape_load() keeps
+// every member of an object as written, duplicate keys included, while
+// json_tape_make() only has the ones left in the tree
+#define JSON_TAPE_TAG(word) ((char)((word) >> 56))
+#define JSON_TAPE_PAYLOAD(word) ((word) & (((uint64_t)1 << 56) - 1))
+
+typedef struct json_tape {
+    uint64_t *words;
+    size_t size, cap;
+    char *strings; // decoded, length prefixed and NUL terminated
+    size_t strings_size, strings_cap;
+} json_tape_t;
+
+// a value on a tape, copied around by value
+typedef struct json_tape_value {
+    const json_tape_t *tape;
+    size_t index;
+} json_tape_value_t;
+
+// iterates the children of an object or array, see json_tape_next()
+typedef struct json_tape_iter {
+    const json_tape_t *tape;
+    size_t index, end;
+    bool object;
+
+    // key of the member the last json_tape_next() returned, strings can't
+    // hold a NUL so this is as long as its strlen()
+    const char *key;
+} json_tape_iter_t;
+
+// parses text straight into a tape, without building any objects. empty text
+// gives an empty tape with a size of 0
+void json_tape_load(json_tape_t *, const char *text, size_t len);
+// flattens the tree under root into a tape
+void json_tape_make(json_tape_t *, json_object_t *root);
+void json_tape_free(json_tape_t *);
+
+json_tape_value_t json_tape_root(const json_tape_t *);
+json_type_e json_tape_type(json_tape_value_t);
+// whether a JSON_NUMBER is stored as an int64_t
+bool json_tape_is_int(json_tape_value_t);
+// number of members or elements, this is O(1). members with duplicate keys
+// are each counted
+size_t json_tape_size(json_tape_value_t);
+const char *json_tape_string(json_tape_value_t, size_t *out_len);
+double json_tape_number(json_tape_value_t);
+int64_t json_tape_int64(json_tape_value_t);
+bool json_tape_bool(json_tape_value_t);
+// finds a member or an element by scanning, returns false if there isn't one.
+// of members with the same key the last is found, as when loading a tree
+bool json_tape_get(json_tape_value_t, const char *key, json_tape_value_t *out);
+bool json_tape_at(json_tape_value_t, size_t index, json_tape_value_t *out);
+
+// json_tape_iter_t iter = json_tape_iter(array);
+// json_tape_value_t value;
+//
+// while (json_tape_next(&iter, &value)) { ... }
+json_tape_iter_t json_tape_iter(json_tape_value_t);
+bool json_tape_next(json_tape_iter_t *, json_tape_value_t *out);
+
 #ifdef GHH_JSON_IMPL
 
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <float.h>
+#include <limits.h>
+#include <setjmp.h>
+#include <stdarg.h>
 
 // errors + debugging ==========================================================
 
@@ -127,14 +606,30 @@ json_object_t *json_copy(json_t *, json_object_t *);
         exit(-1);\
     } while (0)
 
-#define JSON_CTX_ERROR(ctx, ...)\
+// json_t counters, see json_stats_t
+#ifdef JSON_STATS
+#define JSON_STAT_ADD(json, field, n) ((json)->stats.field += (n))
+#define JSON_STAT_MAX(json, field, n)\
+    ((json)->stats.field = (n) > (json)->stats.field ? (n) : (json)->stats.field)
+#else
+#define JSON_STAT_ADD(json, field, n) ((void)0)
+#define JSON_STAT_MAX(json, field, n) ((void)(n))
+#endif
+
+// with a handler set on ctx the error is reported to it instead
+#define JSON_CTX_ERROR_CODE(ctx, code, ...)\
     do {\
+        if ((ctx)->error)\
+            json_ctx_raise(ctx, code, __VA_ARGS__);\
         fprintf(stderr, "JSON ERROR: ");\
         fprintf(stderr, __VA_ARGS__);\
         json_contextual_error(ctx);\
         exit(-1);\
     } while (0)
 
+#define JSON_CTX_ERROR(ctx, ...)\
+    JSON_CTX_ERROR_CODE(ctx, JSON_ERR_SYNTAX, __VA_ARGS__)
+
 #ifndef NDEBUG
 // could do this with an X macro but I think it would reduce clarity
 static const char *json_types[] = {
@@ -151,9 +646,59 @@ static const char *json_types[] = {
 typedef struct json_ctx {
     json_t *json;
     const char *text;
-    size_t index;
+    char *insitu; // mutable text when parsing with JSON_LOAD_INSITU
+    size_t index, len;
+
+    // children of the containers being parsed, see json_scratch_push
+    const json_allocator_t *allocator;
+    char *scratch;
+    size_t scratch_size, scratch_cap;
+
+    // strings are decoded on top of the scratch stack instead of a json_t,
+    // and only live until the next string
+    bool transient;
+
+    // containers are skipped over and parsed once they're accessed. nodes
+    // are every container of the text in document order, node is the next
+    // one the parser can meet and node_end is past the last it can meet
+    bool lazy;
+    const struct json_lazy_node *nodes;
+    size_t node, node_end;
+
+    // strings are shared through the json_t's intern table
+    bool intern;
+
+    // errors longjmp() here with error filled in rather than exiting, see
+    // json_try_parse()
+    json_error_t *error;
+    jmp_buf *jmp;
 } json_ctx_t;
 
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((format(printf, 3, 4), noreturn))
+#endif
+static void json_ctx_raise(
+    json_ctx_t *ctx, json_error_e code, const char *fmt, ...
+) {
+    json_error_t *error = ctx->error;
+    va_list args;
+
+    error->code = code;
+    error->offset = ctx->index;
+
+    va_start(args, fmt);
+    vsnprintf(error->message, sizeof(error->message), fmt, args);
+    va_end(args);
+
+    // messages are written for stderr
+    size_t len = strlen(error->message);
+
+    if (len && error->message[len - 1] == '\n')
+        error->message[len - 1] = '\0';
+
+    longjmp(*ctx->jmp, 1);
+}
+
 static void json_contextual_error(json_ctx_t *ctx) {
     // get line number and line index
     size_t line = 1, line_index = 0;
@@ -169,7 +714,7 @@ static void json_contextual_error(json_ctx_t *ctx) {
     size_t i = line_index;
     int line_length = 0;
 
-    while (ctx->text[i] != '\n' && ctx->text[i] != '\0') {
+    while (i < ctx->len && ctx->text[i] != '\n' && ctx->text[i] != '\0') {
         ++line_length;
         ++i;
     }
@@ -183,21 +728,39 @@ static void json_contextual_error(json_ctx_t *ctx) {
 
 #ifndef JSON_MALLOC
 #define JSON_MALLOC(size) malloc(size)
+// only assumed to pair with the default JSON_MALLOC, buffers are copied by
+// hand for custom allocators without one
+#ifndef JSON_REALLOC
+#define JSON_REALLOC(ptr, size) realloc(ptr, size)
+#endif
 #endif
 #ifndef JSON_FREE
 #define JSON_FREE(ptr) free(ptr)
 #endif
 
-// size of fread() buffer
+// initial size of the fread() buffer, used when a file can't be mapped or
+// measured beforehand
 #ifndef JSON_FREAD_BUF_SIZE
 #define JSON_FREAD_BUF_SIZE 4096
 #endif
 
-// size of each json_t allocator page, increasing this results pretty directly
-// in less cache misses
+// size of the first json_t allocator page, increasing this results pretty
+// directly in less cache misses. each new page doubles in size up to
+// JSON_MAX_PAGE_SIZE
 #ifndef JSON_PAGE_SIZE
 #define JSON_PAGE_SIZE 65536
 #endif
+#ifndef JSON_MAX_PAGE_SIZE
+#define JSON_MAX_PAGE_SIZE (JSON_PAGE_SIZE << 8)
+#endif
+
+// loading reserves this many page bytes per byte of text up front, minified
+// text takes about 4. reserved malloc() memory isn't touched until it's used,
+// so only json_t's on the default allocator reserve. define this as 0 to only
+// grow pages as needed
+#ifndef JSON_RESERVE_RATIO
+#define JSON_RESERVE_RATIO 4
+#endif
 
 // initial sizes of stretchy buffers for json_t allocators
 #define JSON_INIT_PAGE_CAP 8
@@ -208,43 +771,172 @@ typedef struct json_tptr {
     size_t size, index;
 } json_tptr_t;
 
-// fat functions use fat pointers to track memory allocation with JSON_MALLOC
-// and JSON_FREE. this is useful for allocating things that aren't on a json_t
-// allocator
-static void *json_fat_alloc(size_t size) {
-    size_t *ptr = (size_t *)JSON_MALLOC(sizeof(*ptr) + size);
+static void *json_default_alloc(void *user, size_t size) {
+    (void)user;
 
-    *ptr++ = size;
+    return JSON_MALLOC(size);
+}
 
-    return ptr;
+static void *json_default_resize(
+    void *user, void *ptr, size_t old_size, size_t new_size
+) {
+    (void)user;
+
+#ifdef JSON_REALLOC
+    (void)old_size;
+
+    return JSON_REALLOC(ptr, new_size);
+#else
+    void *new_ptr = JSON_MALLOC(new_size);
+
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+    JSON_FREE(ptr);
+
+    return new_ptr;
+#endif
+}
+
+static void json_default_release(void *user, void *ptr, size_t size) {
+    (void)user;
+    (void)size;
+
+    JSON_FREE(ptr);
+}
+
+static const json_allocator_t json_default_allocator = {
+    json_default_alloc,
+    json_default_resize,
+    json_default_release,
+    NULL
+};
+
+static inline void *json_alloc(const json_allocator_t *allocator, size_t size) {
+    return allocator->alloc(allocator->user, size);
+}
+
+static inline void *json_resize(
+    const json_allocator_t *allocator, void *ptr, size_t old_size,
+    size_t new_size
+) {
+    return allocator->resize(allocator->user, ptr, old_size, new_size);
+}
+
+static inline void json_release(
+    const json_allocator_t *allocator, void *ptr, size_t size
+) {
+    allocator->release(allocator->user, ptr, size);
 }
 
-static inline void json_fat_free(void *ptr) {
-    JSON_FREE((size_t *)ptr - 1);
+// bump allocations are aligned like malloc()'s
+#define JSON_BUMP_ALIGN 16
+
+static void *json_bump_alloc(void *user, size_t size) {
+    json_bump_t *bump = (json_bump_t *)user;
+    size_t start = (bump->used + JSON_BUMP_ALIGN - 1)
+                 & ~(size_t)(JSON_BUMP_ALIGN - 1);
+
+    if (start > bump->size || size > bump->size - start)
+        JSON_ERROR("bump allocator out of memory.\n");
+
+    bump->used = start + size;
+
+    return bump->buf + start;
 }
 
-static void *json_fat_realloc(void *ptr, size_t size) {
-    void *new_ptr = json_fat_alloc(size);
+static inline bool json_bump_is_last(
+    json_bump_t *bump, void *ptr, size_t size
+) {
+    return (char *)ptr + size == bump->buf + bump->used;
+}
+
+static void *json_bump_resize(
+    void *user, void *ptr, size_t old_size, size_t new_size
+) {
+    json_bump_t *bump = (json_bump_t *)user;
+
+    // the most recent allocation can grow and shrink in place
+    if (json_bump_is_last(bump, ptr, old_size)) {
+        size_t start = (size_t)((char *)ptr - bump->buf);
 
-    if (ptr) {
-        // copy min(old_size, new_size)
-        size_t copy_size = *((size_t *)ptr - 1);
+        if (new_size > bump->size - start)
+            JSON_ERROR("bump allocator out of memory.\n");
 
-        if (copy_size > size)
-            copy_size = size;
+        bump->used = start + new_size;
 
-        memcpy(new_ptr, ptr, copy_size);
-        json_fat_free(ptr);
+        return ptr;
     }
 
+    void *new_ptr = json_bump_alloc(user, new_size);
+
+    memcpy(new_ptr, ptr, old_size < new_size ? old_size : new_size);
+
     return new_ptr;
 }
 
-static void *json_tracked_alloc(json_t *json, size_t size) {
-    // allocate tracked pointer
-    json_tptr_t *tptr = (json_tptr_t *)JSON_MALLOC(sizeof(*tptr) + size);
+static void json_bump_release(void *user, void *ptr, size_t size) {
+    json_bump_t *bump = (json_bump_t *)user;
 
-    tptr->size = size;
+    if (json_bump_is_last(bump, ptr, size))
+        bump->used = (size_t)((char *)ptr - bump->buf);
+}
+
+json_allocator_t json_bump_allocator(json_bump_t *bump, void *buf, size_t size) {
+    json_allocator_t allocator;
+
+    bump->buf = (char *)buf;
+    bump->size = size;
+    bump->used = 0;
+
+    allocator.alloc = json_bump_alloc;
+    allocator.resize = json_bump_resize;
+    allocator.release = json_bump_release;
+    allocator.user = bump;
+
+    return allocator;
+}
+
+// fat functions use fat pointers to track the size of memory from an
+// allocator. this is useful for allocating things that aren't on a json_t
+// page
+static void *json_fat_alloc(const json_allocator_t *allocator, size_t size) {
+    size_t *ptr = (size_t *)json_alloc(allocator, sizeof(*ptr) + size);
+
+    *ptr++ = size;
+
+    return ptr;
+}
+
+static inline size_t json_fat_size(void *ptr) {
+    return *((size_t *)ptr - 1);
+}
+
+static inline void json_fat_free(const json_allocator_t *allocator, void *ptr) {
+    size_t *base = (size_t *)ptr - 1;
+
+    json_release(allocator, base, sizeof(*base) + *base);
+}
+
+static void *json_fat_realloc(
+    const json_allocator_t *allocator, void *ptr, size_t size
+) {
+    if (!ptr)
+        return json_fat_alloc(allocator, size);
+
+    size_t *base = (size_t *)ptr - 1;
+
+    base = (size_t *)json_resize(
+        allocator,
+        base,
+        sizeof(*base) + *base,
+        sizeof(*base) + size
+    );
+    *base++ = size;
+
+    return base;
+}
+
+// pushes tptr on the tracked array
+static void json_track(json_t *json, json_tptr_t *tptr) {
     tptr->index = json->cur_tracked++;
 
     // push tracked pointer on tracked array
@@ -253,6 +945,7 @@ static void *json_tracked_alloc(json_t *json, size_t size) {
 
         json->tracked_cap <<= 1;
         json->tracked = (json_tptr_t **)json_fat_realloc(
+            &json->allocator,
             json->tracked,
             json->tracked_cap * sizeof(*json->tracked)
         );
@@ -262,84 +955,140 @@ static void *json_tracked_alloc(json_t *json, size_t size) {
     }
 
     json->tracked[tptr->index] = tptr;
+}
+
+static void *json_tracked_alloc(json_t *json, size_t size) {
+    // allocate tracked pointer
+    json_tptr_t *tptr = (json_tptr_t *)json_alloc(
+        &json->allocator,
+        sizeof(*tptr) + size
+    );
+
+    tptr->size = size;
+    json_track(json, tptr);
+
+    JSON_STAT_ADD(json, tracked, 1);
+    JSON_STAT_ADD(json, tracked_bytes, size);
 
     JSON_DEBUG("tracked alloc %zu.\n", tptr->index);
 
     return tptr + 1;
 }
 
+static inline void json_release_tracked(json_t *json, size_t index) {
+    json_tptr_t *tptr = json->tracked[index];
+
+    json_release(&json->allocator, tptr, sizeof(*tptr) + tptr->size);
+}
+
 static void json_tracked_free(json_t *json, void *ptr) {
     size_t index = ((json_tptr_t *)ptr - 1)->index;
 
-    JSON_FREE(json->tracked[index]);
+    json_release_tracked(json, index);
 
     json->tracked[index] = NULL;
 
     JSON_DEBUG("tracked free %zu.\n", index);
 }
 
-// does NOT handle null pointers
-static void *json_tracked_realloc(json_t *json, void *ptr, size_t size) {
-    JSON_ASSERT(ptr, "json_tracked_realloc doesn't support null pointers.\n");
+// page allocations are aligned for any json value unless they're strings
+#define JSON_PAGE_ALIGN 8
+#define JSON_ALIGN(size)\
+    (((size) + JSON_PAGE_ALIGN - 1) & ~(size_t)(JSON_PAGE_ALIGN - 1))
 
-    // allocate new tracked pointer
-    json_tptr_t *old_tptr = (json_tptr_t *)ptr - 1;
-    json_tptr_t *new_tptr = (json_tptr_t *)JSON_MALLOC(
-        sizeof(*new_tptr) + size
-    );
+// makes pages[cur_page + 1] a page with room for size bytes. the first page
+// kept by json_reset() that fits is reused, otherwise a page of page_size is
+// inserted
+static void json_take_page(json_t *json, size_t size, size_t page_size) {
+    size_t next = json->cur_page + 1;
+
+    for (size_t i = next; i < json->page_count; ++i) {
+        if (json_fat_size(json->pages[i]) >= size) {
+            char *page = json->pages[i];
 
-    new_tptr->size = size;
-    new_tptr->index = old_tptr->index;
+            json->pages[i] = json->pages[next];
+            json->pages[next] = page;
+
+            return;
+        }
+    }
 
-    // copy data
-    size_t copy_size = old_tptr->size > new_tptr->size
-        ? new_tptr->size : old_tptr->size;
+    JSON_DEBUG("allocating new page.\n");
 
-    memcpy(new_tptr + 1, ptr, copy_size);
+    if (page_size < size)
+        page_size = size;
 
-    // replace old_tptr in tracked array
-    JSON_FREE(old_tptr);
+    if (json->page_count == json->page_cap) {
+        json->page_cap <<= 1;
+        json->pages = (char **)json_fat_realloc(
+            &json->allocator,
+            json->pages,
+            json->page_cap * sizeof(*json->pages)
+        );
+    }
 
-    json->tracked[new_tptr->index] = new_tptr;
+    // kept pages stay around for later
+    memmove(
+        json->pages + next + 1,
+        json->pages + next,
+        (json->page_count - next) * sizeof(*json->pages)
+    );
 
-    JSON_DEBUG("tracked realloc %zu.\n", new_tptr->index);
+    json->pages[next] = (char *)json_fat_alloc(&json->allocator, page_size);
+    ++json->page_count;
 
-    return new_tptr + 1;
+    JSON_STAT_ADD(json, pages, 1);
+    JSON_STAT_ADD(json, page_bytes, page_size);
 }
 
-// allocates on a json_t page
-static void *json_page_alloc(json_t *json, size_t size) {
-    // allocate new page when needed
-    if (json->used + size > JSON_PAGE_SIZE) {
-        if (size >= JSON_PAGE_SIZE) {
-            JSON_DEBUG("allocating custom page and new page.\n");
+// moves to the next page
+static void json_next_page(json_t *json, size_t size, size_t page_size) {
+    json_take_page(json, size, page_size);
 
-            // size too big for pages, give this pointer its own page
-            json->pages[++json->cur_page] = (char *)JSON_MALLOC(size);
+    ++json->cur_page;
+    json->used = 0;
+    json->page_size = json_fat_size(json->pages[json->cur_page]);
+}
 
-            void *ptr = json->pages[json->cur_page];
+static void *json_page_alloc_slow(json_t *json, size_t size) {
+    // big allocations get a page of their own, which is slotted in under the
+    // current page so that its remainder is still used
+    if (size > json->page_size >> 1) {
+        JSON_DEBUG("allocating dedicated page.\n");
 
-            json->pages[++json->cur_page] = (char *)JSON_MALLOC(JSON_PAGE_SIZE);
-            json->used = 0;
+        json_take_page(json, size, size);
 
-            return ptr;
-        } else {
-            JSON_DEBUG("allocating new page.\n");
-
-            // allocate new page
-            if (++json->cur_page == json->page_cap) {
-                json->page_cap <<= 1;
-                json->pages = (char **)json_fat_realloc(
-                    json->pages,
-                    json->page_cap * sizeof(*json->pages)
-                );
-            }
+        char **pages = json->pages + json->cur_page;
+        char *page = pages[1];
 
-            json->pages[json->cur_page] = (char *)JSON_MALLOC(JSON_PAGE_SIZE);
-            json->used = 0;
-        }
+        pages[1] = pages[0];
+        pages[0] = page;
+        ++json->cur_page;
+
+        return page;
     }
 
+    json_next_page(json, size, json->grow_size);
+
+    if (json->grow_size < JSON_MAX_PAGE_SIZE)
+        json->grow_size <<= 1;
+
+    void *ptr = json->pages[json->cur_page];
+
+    json->used = size;
+
+    return ptr;
+}
+
+// allocates on a json_t page, align must be a power of 2
+static void *json_page_alloc_aligned(json_t *json, size_t size, size_t align) {
+    JSON_STAT_ADD(json, used, size);
+
+    json->used = (json->used + align - 1) & ~(align - 1);
+
+    if (json->used + size > json->page_size)
+        return json_page_alloc_slow(json, size);
+
     // return page space
     void *ptr = json->pages[json->cur_page] + json->used;
 
@@ -348,301 +1097,999 @@ static void *json_page_alloc(json_t *json, size_t size) {
     return ptr;
 }
 
-// array (vector) ==============================================================
+static inline void *json_page_alloc(json_t *json, size_t size) {
+    return json_page_alloc_aligned(json, size, JSON_PAGE_ALIGN);
+}
 
-#define JSON_VEC_INIT_CAP 8
+static inline char *json_page_alloc_str(json_t *json, size_t len) {
+    return (char *)json_page_alloc_aligned(json, len + 1, 1);
+}
 
-typedef struct json_vec {
-    void **data; // fat ptr
-    size_t size, cap, min_cap;
-} json_vec_t;
+// interning ===================================================================
 
-static void json_vec_alloc_one(json_t *json, json_vec_t *vec) {
-    if (vec->size + 1 > vec->cap) {
-        vec->cap <<= 1;
-        vec->data = (void **)json_tracked_realloc(
-            json,
-            vec->data,
-            vec->cap * sizeof(*vec->data)
-        );
-    }
-}
+// strings from JSON_LOAD_INTERN loads at or under this length are interned as
+// well as keys, 0 only interns keys
+#ifndef JSON_INTERN_MAX_LEN
+#define JSON_INTERN_MAX_LEN 16
+#endif
 
-static void json_vec_free_one(json_t *json, json_vec_t *vec) {
-    JSON_ASSERT(vec->size, "popped from vec of size zero.\n");
+#define JSON_INTERN_INIT_CAP 256
 
-    if (vec->cap > vec->min_cap && vec->size < vec->cap >> 2) {
-        vec->cap >>= 1;
-        vec->data = (void **)json_tracked_realloc(
-            json,
-            vec->data,
-            vec->cap * sizeof(*vec->data)
+typedef struct json_intern {
+    json_hash_t hash;
+    size_t len;
+    char *str; // NULL for empty slots
+} json_intern_t;
+
+static void json_interns_free(json_t *json) {
+    if (json->interns) {
+        json_release(
+            &json->allocator,
+            json->interns,
+            json->intern_cap * sizeof(*json->interns)
         );
     }
 
-    --vec->size;
+    json->interns = NULL;
+    json->intern_count = json->intern_cap = 0;
 }
 
-static void json_vec_make(json_t *json, json_vec_t *vec, size_t init_cap) {
-    vec->size = 0;
-    vec->min_cap = vec->cap = init_cap;
+static inline void json_intern_insert(
+    json_intern_t *interns, size_t cap, json_intern_t entry
+) {
+    size_t index = (size_t)entry.hash & (cap - 1);
+
+    while (interns[index].str)
+        index = (index + 1) & (cap - 1);
 
-    vec->data = (void **)json_tracked_alloc(
-        json,
-        vec->cap * sizeof(*vec->data)
-    );
+    interns[index] = entry;
 }
 
-static void json_vec_push(json_t *json, json_vec_t *vec, void *item) {
-    json_vec_alloc_one(json, vec);
-    vec->data[vec->size++] = item;
+// doubles the table to keep it at most half full
+static void json_interns_grow(json_t *json) {
+    size_t cap = json->intern_cap ? json->intern_cap << 1 : JSON_INTERN_INIT_CAP;
+    json_intern_t *interns = (json_intern_t *)json_alloc(
+        &json->allocator,
+        cap * sizeof(*interns)
+    );
+
+    memset(interns, 0, cap * sizeof(*interns));
+
+    for (size_t i = 0; i < json->intern_cap; ++i)
+        if (json->interns[i].str)
+            json_intern_insert(interns, cap, json->interns[i]);
+
+    size_t count = json->intern_count;
+
+    json_interns_free(json);
+
+    json->interns = interns;
+    json->intern_count = count;
+    json->intern_cap = cap;
 }
 
-static void *json_vec_pop(json_t *json, json_vec_t *vec) {
-    json_object_t *object = (json_object_t *)vec->data[vec->size - 1];
-    json_vec_free_one(json, vec);
+// returns the json_t's copy of str, copying it to a page the first time
+static char *json_intern_mem(
+    json_t *json, const char *str, size_t len, json_hash_t hash
+) {
+    if ((json->intern_count + 1) * 2 > json->intern_cap)
+        json_interns_grow(json);
+
+    size_t mask = json->intern_cap - 1;
+    size_t index = (size_t)hash & mask;
+    json_intern_t *entry;
 
-    return object;
+    while ((entry = &json->interns[index])->str) {
+        if (entry->hash == hash && entry->len == len
+         && !memcmp(entry->str, str, len))
+            return entry->str;
+
+        index = (index + 1) & mask;
+    }
+
+    entry->hash = hash;
+    entry->len = len;
+    entry->str = json_page_alloc_str(json, len);
+
+    memcpy(entry->str, str, len);
+    entry->str[len] = '\0';
+
+    ++json->intern_count;
+
+    return entry->str;
 }
 
-static void *json_vec_del(json_t *json, json_vec_t *vec, size_t index) {
+// moves the pages and tracked allocations holding src's objects to json, which
+// frees them from then on
+void json_absorb(json_t *json, json_t *src) {
+    const json_allocator_t *allocator = &json->allocator;
+    size_t count = src->cur_page + 1;
+
+    JSON_ASSERT(!src->file_text, "can't absorb a json_t holding a file.\n");
+    JSON_ASSERT(!json->frozen, "attempted to modify a frozen json_t.\n");
     JSON_ASSERT(
-        index < vec->size,
-        "attempted to delete vec item past it's size.\n"
+        src->allocator.alloc == allocator->alloc
+     && src->allocator.user == allocator->user,
+        "can't absorb a json_t with a different allocator.\n"
+    );
+
+    // pages in use go under json's current page, kept ones aren't needed
+    for (size_t i = count; i < src->page_count; ++i)
+        json_fat_free(allocator, src->pages[i]);
+
+    if (json->page_count + count > json->page_cap) {
+        while (json->page_count + count > json->page_cap)
+            json->page_cap <<= 1;
+
+        json->pages = (char **)json_fat_realloc(
+            allocator,
+            json->pages,
+            json->page_cap * sizeof(*json->pages)
+        );
+    }
+
+    memmove(
+        json->pages + json->cur_page + count,
+        json->pages + json->cur_page,
+        (json->page_count - json->cur_page) * sizeof(*json->pages)
     );
+    memcpy(json->pages + json->cur_page, src->pages, count * sizeof(*src->pages));
+
+    json->cur_page += count;
+    json->page_count += count;
+
+    for (size_t i = 0; i < src->cur_tracked; ++i)
+        if (src->tracked[i])
+            json_track(json, src->tracked[i]);
 
-    void *item = vec->data[index];
+    JSON_STAT_ADD(json, pages, src->stats.pages);
+    JSON_STAT_ADD(json, page_bytes, src->stats.page_bytes);
+    JSON_STAT_ADD(json, used, src->stats.used);
+    JSON_STAT_ADD(json, tracked, src->stats.tracked);
+    JSON_STAT_ADD(json, tracked_bytes, src->stats.tracked_bytes);
+    JSON_STAT_ADD(json, rehashes, src->stats.rehashes);
+    JSON_STAT_MAX(json, max_probe, src->stats.max_probe);
 
-    vec->data[index] = json_vec_pop(json, vec);
+    json_fat_free(allocator, src->pages);
+    json_fat_free(allocator, src->tracked);
+    json_interns_free(src);
 
-    return item;
+    if (src->scratch)
+        json_release(allocator, src->scratch, src->scratch_cap);
 }
 
-static void *json_vec_del_ordered(
-    json_t *json, json_vec_t *vec, size_t index
+// array (vector) ==============================================================
+
+// arrays can't grow once they're made, so their storage is always an exact
+// size page allocation
+typedef struct json_vec {
+    void **data;
+    size_t size;
+} json_vec_t;
+
+// allocates a vec with room for size children in one page allocation. when
+// out_values is given, the children are stored in the same block and data
+// points at them
+static json_vec_t *json_vec_alloc(
+    json_t *json, size_t size, json_object_t **out_values
 ) {
-    JSON_ASSERT(
-        index < vec->size,
-        "attempted to delete vec item past it's size.\n"
+    size_t vec_size = JSON_ALIGN(sizeof(json_vec_t));
+    size_t values_size = out_values ? size * sizeof(json_object_t) : 0;
+    char *block = (char *)json_page_alloc(
+        json,
+        vec_size + values_size + size * sizeof(void *)
     );
 
-    void *item = vec->data[index];
+    json_vec_t *vec = (json_vec_t *)block;
 
-    memcpy(
-        vec->data + index,
-        vec->data + index + 1,
-        (vec->size - index - 1)  * sizeof(*vec->data)
-    );
+    vec->data = (void **)(block + vec_size + values_size);
+    vec->size = size;
 
-    json_vec_free_one(json, vec);
+    if (out_values) {
+        json_object_t *values = (json_object_t *)(block + vec_size);
+
+        for (size_t i = 0; i < size; ++i)
+            vec->data[i] = &values[i];
+
+        *out_values = values;
+    }
 
-    return item;
+    return vec;
 }
 
 // hashmap =====================================================================
 
+// entries are kept in insertion order as parallel arrays sharing one block.
+// small objects are searched linearly, past JSON_HMAP_FLAT_MAX entries a robin
+// hood index is built over them
+//
+// maps built by the parser or json_copy live in a single page allocation and
+// are only moved to tracked memory if they're grown later
+// entries a map built by json_put() first grows to
+#ifndef JSON_HMAP_INIT_CAP
 #define JSON_HMAP_INIT_CAP 8
-
-#if INTPTR_MAX == INT64_MAX
-// 64 bit
-typedef uint64_t json_hash_t;
-#define JSON_FNV_PRIME 0x00000100000001b3
-#define JSON_FNV_BASIS 0xcbf29ce484222325
-#else
-// 32 bit
-typedef uint32_t json_hash_t;
-#define JSON_FNV_PRIME 0x01000193a
-#define JSON_FNV_BASIS 0x0811c9dc5
 #endif
+#define JSON_HMAP_FLAT_MAX 8
+#define JSON_HMAP_INIT_SLOTS 16
 
-typedef struct json_hnode {
-    json_object_t *object;
-    json_hash_t hash;
-    size_t index, steps;
-} json_hnode_t;
+// index slot, refers to an entry
+typedef struct json_hslot {
+    uint32_t entry; // entry index + 1, 0 for empty slots
+    uint32_t hash; // low bits of the entry hash, enough to find its home slot
+} json_hslot_t;
 
 typedef struct json_hmap {
-    json_vec_t vec; // stores keys in order
-    json_hnode_t *nodes; // fat ptr
-    size_t size, cap, min_cap;
+    json_hash_t *hashes;
+    size_t *lens;
+    char **keys;
+    json_object_t **objects;
+    size_t size, cap;
+
+    json_hslot_t *slots; // NULL while the map is flat
+    size_t slot_cap; // power of 2
+
+    // whether entries and slots are tracked allocations or page memory
+    bool entries_tracked, slots_tracked;
 } json_hmap_t;
 
+#define JSON_HMAP_ENTRY_SIZE\
+    (sizeof(json_hash_t) + sizeof(size_t) + sizeof(char *)\
+     + sizeof(json_object_t *))
+
 // fnv-1a hash function (http://isthe.com/chongo/tech/comp/fnv/)
-static json_hash_t json_hash_str(char *str) {
+static inline json_hash_t json_hash_mem(const char *str, size_t len) {
     json_hash_t hash = JSON_FNV_BASIS;
 
-    while (*str)
-        hash = (hash ^ *str++) * JSON_FNV_PRIME;
+    for (size_t i = 0; i < len; ++i)
+        hash = (hash ^ (unsigned char)str[i]) * JSON_FNV_PRIME;
 
     return hash;
 }
 
-static json_hnode_t *json_hnodes_alloc(json_t *json, size_t num_nodes) {
-    json_hnode_t *nodes = (json_hnode_t *)json_tracked_alloc(
-        json,
-        num_nodes * sizeof(*nodes)
-    );
+// hashes a NUL terminated string and measures its length in one pass
+static inline json_hash_t json_hash_str(const char *str, size_t *out_len) {
+    json_hash_t hash = JSON_FNV_BASIS;
+    const char *iter = str;
+
+    while (*iter)
+        hash = (hash ^ (unsigned char)*iter++) * JSON_FNV_PRIME;
 
-    for (size_t i = 0; i < num_nodes; ++i)
-        nodes[i].hash = 0;
+    *out_len = (size_t)(iter - str);
 
-    return nodes;
+    return hash;
 }
 
-static bool json_hmap_put_node(json_t *, json_hmap_t *, json_hnode_t *);
+static inline bool json_hmap_entry_matches(
+    json_hmap_t *hmap, size_t entry, const char *key, size_t len,
+    json_hash_t hash
+) {
+    return hmap->hashes[entry] == hash && hmap->lens[entry] == len
+        && (hmap->keys[entry] == key || !memcmp(hmap->keys[entry], key, len));
+}
 
-static void json_hmap_rehash(json_t *json, json_hmap_t *hmap, size_t new_cap) {
-    json_hnode_t *old_nodes = hmap->nodes;
-    size_t old_cap = hmap->cap;
+// points entry arrays at a block of cap * JSON_HMAP_ENTRY_SIZE bytes
+static void json_hmap_set_entries(json_hmap_t *hmap, char *block, size_t cap) {
+    hmap->hashes = (json_hash_t *)block;
+    hmap->lens = (size_t *)(hmap->hashes + cap);
+    hmap->keys = (char **)(hmap->lens + cap);
+    hmap->objects = (json_object_t **)(hmap->keys + cap);
+    hmap->cap = cap;
+}
 
-    hmap->cap = new_cap;
-    hmap->nodes = json_hnodes_alloc(json, hmap->cap);
-    hmap->size = 0;
+// reallocates entry arrays as tracked memory, keeping the first hmap->size
+// entries
+static void json_hmap_alloc_entries(
+    json_t *json, json_hmap_t *hmap, size_t cap
+) {
+    json_hmap_t old = *hmap;
 
-    for (size_t i = 0; i < old_cap; ++i) {
-        if (old_nodes[i].hash) {
-            old_nodes[i].index = old_nodes[i].hash % hmap->cap;
-            old_nodes[i].steps = 0;
+    json_hmap_set_entries(
+        hmap,
+        (char *)json_tracked_alloc(json, cap * JSON_HMAP_ENTRY_SIZE),
+        cap
+    );
 
-            json_hmap_put_node(json, hmap, &old_nodes[i]);
-        }
+    if (old.cap) {
+        memcpy(hmap->hashes, old.hashes, old.size * sizeof(*old.hashes));
+        memcpy(hmap->lens, old.lens, old.size * sizeof(*old.lens));
+        memcpy(hmap->keys, old.keys, old.size * sizeof(*old.keys));
+        memcpy(hmap->objects, old.objects, old.size * sizeof(*old.objects));
+
+        if (old.entries_tracked)
+            json_tracked_free(json, old.hashes);
     }
 
-    json_tracked_free(json, old_nodes);
+    hmap->entries_tracked = true;
 }
 
-static inline void json_hmap_alloc_slot(json_t *json, json_hmap_t *hmap) {
-    if (hmap->size + 1 > hmap->cap >> 1)
-        json_hmap_rehash(json, hmap, hmap->cap << 1);
-
-    ++hmap->size;
-}
+// returns slot count that keeps size entries under a load factor of 3/4
+static size_t json_hmap_slot_cap(size_t size, size_t slot_cap) {
+    if (!slot_cap)
+        slot_cap = JSON_HMAP_INIT_SLOTS;
 
-static inline void json_hmap_free_slot(json_t *json, json_hmap_t *hmap) {
-    if (hmap->size < hmap->cap >> 2 && hmap->cap > hmap->min_cap)
-        json_hmap_rehash(json, hmap, hmap->cap >> 1);
+    while (size * 4 > slot_cap * 3)
+        slot_cap <<= 1;
 
-    --hmap->size;
+    return slot_cap;
 }
 
-static void json_hmap_make(json_t *json, json_hmap_t *hmap, size_t init_cap) {
-    json_vec_make(json, &hmap->vec, init_cap);
+// allocates a map with room for size entries in one page allocation, with its
+// index already sized. values are stored in the same block like json_vec_alloc
+static json_hmap_t *json_hmap_alloc(
+    json_t *json, size_t size, json_object_t **out_values
+) {
+    size_t slot_cap = size > JSON_HMAP_FLAT_MAX
+        ? json_hmap_slot_cap(size, 0) : 0;
 
-    hmap->size = 0;
-    hmap->cap = hmap->min_cap = init_cap;
-    hmap->nodes = json_hnodes_alloc(json, hmap->cap);
-}
+    size_t hmap_size = JSON_ALIGN(sizeof(json_hmap_t));
+    size_t values_size = out_values ? size * sizeof(json_object_t) : 0;
+    size_t entries_size = size * JSON_HMAP_ENTRY_SIZE;
+    size_t slots_size = slot_cap * sizeof(json_hslot_t);
 
-static json_hnode_t *json_hmap_get_node(json_hmap_t *hmap, json_hash_t hash) {
-    size_t index = hash % hmap->cap;
+    char *block = (char *)json_page_alloc(
+        json,
+        hmap_size + values_size + entries_size + slots_size
+    );
 
-    // iterate through hash chain until match or empty node is found
-    while (hmap->nodes[index].hash) {
-        if (hmap->nodes[index].hash == hash)
-            return &hmap->nodes[index];
+    json_hmap_t *hmap = (json_hmap_t *)block;
 
-        index = (index + 1) % hmap->cap;
-    }
+    block += hmap_size;
 
-    return NULL;
-}
+    if (out_values)
+        *out_values = (json_object_t *)block;
 
-// for rehash + put
-// returns whether a previous node has been replaced
-static bool json_hmap_put_node(
-    json_t *json, json_hmap_t *hmap, json_hnode_t *node
-) {
-    size_t index = node->index;
+    block += values_size;
 
-    // find suitable bucket
-    while (hmap->nodes[index].hash) {
-        if (hmap->nodes[index].hash == node->hash) {
-            // found matching bucket
-            hmap->nodes[index].object = node->object;
-            return true;
-        }
+    json_hmap_set_entries(hmap, block, size);
 
-        index = (index + 1) % hmap->cap;
-        ++node->steps;
+    hmap->size = 0;
+    hmap->slots = NULL;
+    hmap->slot_cap = slot_cap;
+    hmap->entries_tracked = hmap->slots_tracked = false;
+
+    if (slot_cap) {
+        hmap->slots = (json_hslot_t *)(block + entries_size);
+        memset(hmap->slots, 0, slots_size);
     }
 
-    // found empty bucket
-    hmap->nodes[index] = *node;
-    json_hmap_alloc_slot(json, hmap);
+    return hmap;
+}
 
-    return false;
+static inline size_t json_hslot_dist(json_hmap_t *hmap, size_t index) {
+    return (index - hmap->slots[index].hash) & (hmap->slot_cap - 1);
 }
 
-static void json_hmap_put(
-    json_t *json, json_hmap_t *hmap, char *key, json_object_t *object
-) {
-    json_hnode_t node;
+// insert entry into index, displacing entries closer to their home slot.
+// returns the most slots probed from any home slot along the way
+static size_t json_hmap_index_entry(json_hmap_t *hmap, size_t entry) {
+    size_t mask = hmap->slot_cap - 1;
+    json_hslot_t slot;
 
-    node.object = object;
-    node.hash = json_hash_str(key);
-    node.index = node.hash % hmap->cap;
+    slot.entry = (uint32_t)entry + 1;
+    slot.hash = (uint32_t)hmap->hashes[entry];
 
-    if (!json_hmap_put_node(json, hmap, &node))
-        json_vec_push(json, &hmap->vec, key);
+    size_t index = slot.hash & mask, dist = 0, probed = 0;
 
-}
+    while (hmap->slots[index].entry) {
+        size_t other_dist = json_hslot_dist(hmap, index);
 
-static json_object_t *json_hmap_get(json_hmap_t *hmap, char *key) {
-    json_hnode_t *node = json_hmap_get_node(hmap, json_hash_str(key));
+        if (other_dist < dist) {
+            json_hslot_t tmp = hmap->slots[index];
 
-    return node ? node->object : NULL;
+            hmap->slots[index] = slot;
+            slot = tmp;
+            dist = other_dist;
+        }
+
+        index = (index + 1) & mask;
+        ++dist;
+
+        if (dist > probed)
+            probed = dist;
+    }
+
+    hmap->slots[index] = slot;
+
+    return probed + 1;
+}
+
+// builds index with slot_cap slots, or drops it for a slot_cap of 0
+static void json_hmap_reindex(json_t *json, json_hmap_t *hmap, size_t slot_cap) {
+    // an index of the same size can be rebuilt in place
+    if (!hmap->slots || slot_cap != hmap->slot_cap) {
+        if (hmap->slots && hmap->slots_tracked)
+            json_tracked_free(json, hmap->slots);
+
+        hmap->slots = NULL;
+        hmap->slot_cap = slot_cap;
+
+        if (!slot_cap)
+            return;
+
+        hmap->slots = (json_hslot_t *)json_tracked_alloc(
+            json,
+            slot_cap * sizeof(*hmap->slots)
+        );
+        hmap->slots_tracked = true;
+    }
+
+    memset(hmap->slots, 0, slot_cap * sizeof(*hmap->slots));
+
+    JSON_STAT_ADD(json, rehashes, 1);
+
+    for (size_t i = 0; i < hmap->size; ++i) {
+        size_t probed = json_hmap_index_entry(hmap, i);
+
+        JSON_STAT_MAX(json, max_probe, probed);
+    }
+}
+
+// returns index of slot referring to an entry matching key, or -1
+static ptrdiff_t json_hmap_find_slot(
+    json_hmap_t *hmap, const char *key, size_t len, json_hash_t hash
+) {
+    size_t mask = hmap->slot_cap - 1;
+    size_t index = (uint32_t)hash & mask, dist = 0;
+
+    while (hmap->slots[index].entry) {
+        // robin hood invariant, key would have displaced this entry
+        if (json_hslot_dist(hmap, index) < dist)
+            break;
+
+        if (hmap->slots[index].hash == (uint32_t)hash
+         && json_hmap_entry_matches(
+            hmap, hmap->slots[index].entry - 1, key, len, hash
+        )) {
+            return (ptrdiff_t)index;
+        }
+
+        index = (index + 1) & mask;
+        ++dist;
+    }
+
+    return -1;
+}
+
+// returns entry matching key, or -1
+static ptrdiff_t json_hmap_find(
+    json_hmap_t *hmap, const char *key, size_t len, json_hash_t hash
+) {
+    if (hmap->slots) {
+        ptrdiff_t index = json_hmap_find_slot(hmap, key, len, hash);
+
+        return index < 0 ? -1 : (ptrdiff_t)hmap->slots[index].entry - 1;
+    }
+
+    for (size_t i = 0; i < hmap->size; ++i)
+        if (json_hmap_entry_matches(hmap, i, key, len, hash))
+            return (ptrdiff_t)i;
+
+    return -1;
+}
+
+// adds an entry known not to be in the map, there must be room for it
+static void json_hmap_append(
+    json_t *json, json_hmap_t *hmap, char *key, size_t len, json_hash_t hash,
+    json_object_t *object
+) {
+    size_t entry = hmap->size++;
+
+    hmap->hashes[entry] = hash;
+    hmap->lens[entry] = len;
+    hmap->keys[entry] = key;
+    hmap->objects[entry] = object;
+
+    // maintain index load factor of 3/4
+    if (hmap->slots && hmap->size * 4 <= hmap->slot_cap * 3) {
+        size_t probed = json_hmap_index_entry(hmap, entry);
+
+        JSON_STAT_MAX(json, max_probe, probed);
+    } else if (hmap->size > JSON_HMAP_FLAT_MAX) {
+        json_hmap_reindex(
+            json,
+            hmap,
+            json_hmap_slot_cap(hmap->size, hmap->slot_cap << 1)
+        );
+    }
+}
+
+static void json_hmap_put_hashed(
+    json_t *json, json_hmap_t *hmap, char *key, size_t len, json_hash_t hash,
+    json_object_t *object
+) {
+    ptrdiff_t found = json_hmap_find(hmap, key, len, hash);
+
+    if (found >= 0) {
+        // replace value of existing key
+        hmap->objects[found] = object;
+        return;
+    }
+
+    if (hmap->size == hmap->cap) {
+        json_hmap_alloc_entries(
+            json,
+            hmap,
+            hmap->cap ? hmap->cap << 1 : JSON_HMAP_INIT_CAP
+        );
+    }
+
+    json_hmap_append(json, hmap, key, len, hash, object);
+}
+
+static void json_hmap_put(
+    json_t *json, json_hmap_t *hmap, char *key, json_object_t *object
+) {
+    size_t len;
+    json_hash_t hash = json_hash_str(key, &len);
+
+    json_hmap_put_hashed(json, hmap, key, len, hash, object);
+}
+
+static json_object_t *json_hmap_get_hashed(
+    json_hmap_t *hmap, const char *key, size_t len, json_hash_t hash
+) {
+    ptrdiff_t entry = json_hmap_find(hmap, key, len, hash);
+
+    return entry >= 0 ? hmap->objects[entry] : NULL;
+}
+
+static json_object_t *json_hmap_get(json_hmap_t *hmap, const char *key) {
+    size_t len;
+    json_hash_t hash = json_hash_str(key, &len);
+
+    return json_hmap_get_hashed(hmap, key, len, hash);
+}
+
+// removes slot from index with backward shift deletion
+static void json_hmap_unindex_slot(json_hmap_t *hmap, size_t index) {
+    size_t mask = hmap->slot_cap - 1;
+    size_t next = (index + 1) & mask;
+
+    while (hmap->slots[next].entry && json_hslot_dist(hmap, next)) {
+        hmap->slots[index] = hmap->slots[next];
+        index = next;
+        next = (next + 1) & mask;
+    }
+
+    hmap->slots[index].entry = 0;
 }
 
 static json_object_t *json_hmap_del(
-    json_t *json, json_hmap_t *hmap, char *key, bool order
+    json_t *json, json_hmap_t *hmap, const char *key, bool order
 ) {
-    json_hash_t hash = json_hash_str(key);
-    size_t index = hash % hmap->cap;
+    size_t len;
+    json_hash_t hash = json_hash_str(key, &len);
+    ptrdiff_t found = json_hmap_find(hmap, key, len, hash);
 
-    // find node
-    while (hmap->nodes[index].hash != hash) {
-        if (!hmap->nodes[index].hash)
-            return NULL; // node doesn't exist
+    if (found < 0)
+        return NULL; // entry doesn't exist
 
-        index = (index + 1) % hmap->cap;
+    size_t entry = (size_t)found;
+    size_t last = hmap->size - 1;
+    json_object_t *object = hmap->objects[entry];
+
+    if (hmap->slots) {
+        json_hmap_unindex_slot(
+            hmap,
+            (size_t)json_hmap_find_slot(hmap, key, len, hash)
+        );
     }
 
-    json_object_t *object = hmap->nodes[index].object;
+    if (order) {
+        // shift following entries down, this invalidates the whole index
+        size_t count = last - entry;
+
+        memmove(hmap->hashes + entry, hmap->hashes + entry + 1,
+                count * sizeof(*hmap->hashes));
+        memmove(hmap->lens + entry, hmap->lens + entry + 1,
+                count * sizeof(*hmap->lens));
+        memmove(hmap->keys + entry, hmap->keys + entry + 1,
+                count * sizeof(*hmap->keys));
+        memmove(hmap->objects + entry, hmap->objects + entry + 1,
+                count * sizeof(*hmap->objects));
+
+        --hmap->size;
+
+        if (hmap->slots && count)
+            json_hmap_reindex(json, hmap, hmap->slot_cap);
+    } else {
+        // move last entry into the gap and repoint its slot
+        if (entry != last) {
+            if (hmap->slots) {
+                size_t index = (size_t)json_hmap_find_slot(
+                    hmap,
+                    hmap->keys[last],
+                    hmap->lens[last],
+                    hmap->hashes[last]
+                );
 
-    // replace chain
-    size_t last = index, steps = 0;
+                hmap->slots[index].entry = (uint32_t)entry + 1;
+            }
 
-    while (hmap->nodes[index = (index + 1) % hmap->cap].hash) {
-        if (hmap->nodes[index].steps >= ++steps) {
-            // found node that is a valid chain replacement
-            hmap->nodes[last] = hmap->nodes[index];
-            hmap->nodes[last].steps -= steps;
-            last = index;
-            steps = 0;
+            hmap->hashes[entry] = hmap->hashes[last];
+            hmap->lens[entry] = hmap->lens[last];
+            hmap->keys[entry] = hmap->keys[last];
+            hmap->objects[entry] = hmap->objects[last];
         }
+
+        --hmap->size;
     }
 
-    // last node in chain is now a duplicate
-    hmap->nodes[last].hash = 0;
-    json_hmap_free_slot(json, hmap);
+    // go back to flat searching once small enough
+    if (hmap->slots && hmap->size <= JSON_HMAP_FLAT_MAX >> 1)
+        json_hmap_reindex(json, hmap, 0);
 
-    // remove key from vec
-    for (size_t i = 0; i < hmap->vec.size; ++i) {
-        if (!strcmp(key, (char *)hmap->vec.data[i])) {
-            if (order)
-                json_vec_del_ordered(json, &hmap->vec, i);
-            else
-                json_vec_del(json, &hmap->vec, i);
+    return object;
+}
 
-            break;
+// scanning kernels ============================================================
+
+// the tokenizer's hot loops are vectorized with the best instruction set the
+// compiler targets. define JSON_NO_SIMD to use the scalar versions
+#ifndef JSON_NO_SIMD
+#if defined(__AVX2__)
+#define JSON_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define JSON_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define JSON_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+
+static inline unsigned json_ctz(uint32_t x) {
+    unsigned long index;
+
+    _BitScanForward(&index, x);
+
+    return (unsigned)index;
+}
+
+static inline unsigned json_ctz64(uint64_t x) {
+    unsigned long index;
+
+    _BitScanForward64(&index, x);
+
+    return (unsigned)index;
+}
+#else
+#define json_ctz(x) ((unsigned)__builtin_ctz(x))
+#define json_ctz64(x) ((unsigned)__builtin_ctzll(x))
+#endif
+
+static inline bool json_is_whitespace(char ch) {
+    switch (ch) {
+    case 0x20:
+    case 0x0A:
+    case 0x0D:
+    case 0x09:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// characters which stop a run of raw string characters
+static inline bool json_is_str_special(char ch) {
+    return ch == '\"' || ch == '\\' || (unsigned char)ch < 0x20;
+}
+
+// returns index of the first non-whitespace character at or after index
+static size_t json_skip_whitespace(const char *text, size_t index, size_t len) {
+    // most tokens are directly adjacent, don't bother vectorizing those
+    if (index < len && !json_is_whitespace(text[index]))
+        return index;
+
+#if defined(JSON_AVX2)
+    const __m256i space = _mm256_set1_epi8(' '), nl = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r'), tab = _mm256_set1_epi8('\t');
+
+    for (; index + 32 <= len; index += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + index));
+        __m256i ws = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, nl)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, tab))
+        );
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(ws);
+
+        if (mask)
+            return index + json_ctz(mask);
+    }
+#elif defined(JSON_SSE2)
+    const __m128i space = _mm_set1_epi8(' '), nl = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r'), tab = _mm_set1_epi8('\t');
+
+    for (; index + 16 <= len; index += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + index));
+        __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, nl)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, tab))
+        );
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(ws) ^ 0xFFFF;
+
+        if (mask)
+            return index + json_ctz(mask);
+    }
+#elif defined(JSON_NEON)
+    const uint8x16_t space = vdupq_n_u8(' '), nl = vdupq_n_u8('\n');
+    const uint8x16_t cr = vdupq_n_u8('\r'), tab = vdupq_n_u8('\t');
+
+    for (; index + 16 <= len; index += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)(text + index));
+        uint8x16_t ws = vorrq_u8(
+            vorrq_u8(vceqq_u8(v, space), vceqq_u8(v, nl)),
+            vorrq_u8(vceqq_u8(v, cr), vceqq_u8(v, tab))
+        );
+        // narrow to 4 bits per byte, there is no movemask on neon
+        uint64_t mask = ~vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(ws), 4)
+        ), 0);
+
+        if (mask)
+            return index + (json_ctz64(mask) >> 2);
+    }
+#endif
+
+    while (index < len && json_is_whitespace(text[index]))
+        ++index;
+
+    return index;
+}
+
+// returns index of the first '"', '\\' or control character at or after index
+static size_t json_scan_string(const char *text, size_t index, size_t len) {
+#if defined(JSON_AVX2)
+    const __m256i quote = _mm256_set1_epi8('\"'), bslash = _mm256_set1_epi8('\\');
+    const __m256i ctrl = _mm256_set1_epi8(0x1F);
+
+    for (; index + 32 <= len; index += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + index));
+        __m256i special = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, quote),
+                _mm256_cmpeq_epi8(v, bslash)
+            ),
+            // unsigned v <= 0x1F
+            _mm256_cmpeq_epi8(_mm256_max_epu8(v, ctrl), ctrl)
+        );
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(special);
+
+        if (mask)
+            return index + json_ctz(mask);
+    }
+#elif defined(JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('\"'), bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1F);
+
+    for (; index + 16 <= len; index += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + index));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+            // unsigned v <= 0x1F
+            _mm_cmpeq_epi8(_mm_max_epu8(v, ctrl), ctrl)
+        );
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(special);
+
+        if (mask)
+            return index + json_ctz(mask);
+    }
+#elif defined(JSON_NEON)
+    const uint8x16_t quote = vdupq_n_u8('\"'), bslash = vdupq_n_u8('\\');
+    const uint8x16_t ctrl = vdupq_n_u8(0x20);
+
+    for (; index + 16 <= len; index += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)(text + index));
+        uint8x16_t special = vorrq_u8(
+            vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, bslash)),
+            vcltq_u8(v, ctrl)
+        );
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(special), 4)
+        ), 0);
+
+        if (mask)
+            return index + (json_ctz64(mask) >> 2);
+    }
+#endif
+
+    while (index < len && !json_is_str_special(text[index]))
+        ++index;
+
+    return index;
+}
+
+// bit i of each mask is set when text[i] of a 64 byte block is that character,
+// open and close are brackets or braces
+typedef struct json_block {
+    uint64_t quote, bslash, comma, open, close;
+} json_block_t;
+
+#if defined(JSON_NEON)
+// packs a neon nibble mask down to a bit per byte
+static inline uint64_t json_pack_nibbles(uint64_t mask) {
+    mask &= 0x1111111111111111;
+    mask = (mask | mask >> 3) & 0x0303030303030303;
+    mask = (mask | mask >> 6) & 0x000F000F000F000F;
+    mask = (mask | mask >> 12) & 0x000000FF000000FF;
+
+    return (mask | mask >> 24) & 0xFFFF;
+}
+#endif
+
+// or-ing 0x20 folds '[' onto '{' and ']' onto '}', nothing else lands on them
+static inline void json_scan_block(const char *text, json_block_t *block) {
+#if defined(JSON_AVX2)
+    const __m256i quote = _mm256_set1_epi8('\"'), bslash = _mm256_set1_epi8('\\');
+    const __m256i comma = _mm256_set1_epi8(','), fold = _mm256_set1_epi8(0x20);
+    const __m256i open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}');
+
+    memset(block, 0, sizeof(*block));
+
+    for (int i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(text + i));
+        __m256i folded = _mm256_or_si256(v, fold);
+
+#define JSON_BLOCK_MASK(cmp)\
+    ((uint64_t)(uint32_t)_mm256_movemask_epi8(cmp) << i)
+        block->quote |= JSON_BLOCK_MASK(_mm256_cmpeq_epi8(v, quote));
+        block->bslash |= JSON_BLOCK_MASK(_mm256_cmpeq_epi8(v, bslash));
+        block->comma |= JSON_BLOCK_MASK(_mm256_cmpeq_epi8(v, comma));
+        block->open |= JSON_BLOCK_MASK(_mm256_cmpeq_epi8(folded, open));
+        block->close |= JSON_BLOCK_MASK(_mm256_cmpeq_epi8(folded, close));
+#undef JSON_BLOCK_MASK
+    }
+#elif defined(JSON_SSE2)
+    const __m128i quote = _mm_set1_epi8('\"'), bslash = _mm_set1_epi8('\\');
+    const __m128i comma = _mm_set1_epi8(','), fold = _mm_set1_epi8(0x20);
+    const __m128i open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}');
+
+    memset(block, 0, sizeof(*block));
+
+    for (int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(text + i));
+        __m128i folded = _mm_or_si128(v, fold);
+
+#define JSON_BLOCK_MASK(cmp) ((uint64_t)(uint32_t)_mm_movemask_epi8(cmp) << i)
+        block->quote |= JSON_BLOCK_MASK(_mm_cmpeq_epi8(v, quote));
+        block->bslash |= JSON_BLOCK_MASK(_mm_cmpeq_epi8(v, bslash));
+        block->comma |= JSON_BLOCK_MASK(_mm_cmpeq_epi8(v, comma));
+        block->open |= JSON_BLOCK_MASK(_mm_cmpeq_epi8(folded, open));
+        block->close |= JSON_BLOCK_MASK(_mm_cmpeq_epi8(folded, close));
+#undef JSON_BLOCK_MASK
+    }
+#elif defined(JSON_NEON)
+    const uint8x16_t quote = vdupq_n_u8('\"'), bslash = vdupq_n_u8('\\');
+    const uint8x16_t comma = vdupq_n_u8(','), fold = vdupq_n_u8(0x20);
+    const uint8x16_t open = vdupq_n_u8('{'), close = vdupq_n_u8('}');
+
+    memset(block, 0, sizeof(*block));
+
+    for (int i = 0; i < 64; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t *)(text + i));
+        uint8x16_t folded = vorrq_u8(v, fold);
+
+#define JSON_BLOCK_MASK(cmp)\
+    (json_pack_nibbles(vget_lane_u64(vreinterpret_u64_u8(\
+        vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4)\
+    ), 0)) << i)
+        block->quote |= JSON_BLOCK_MASK(vceqq_u8(v, quote));
+        block->bslash |= JSON_BLOCK_MASK(vceqq_u8(v, bslash));
+        block->comma |= JSON_BLOCK_MASK(vceqq_u8(v, comma));
+        block->open |= JSON_BLOCK_MASK(vceqq_u8(folded, open));
+        block->close |= JSON_BLOCK_MASK(vceqq_u8(folded, close));
+#undef JSON_BLOCK_MASK
+    }
+#else
+    memset(block, 0, sizeof(*block));
+
+    for (int i = 0; i < 64; ++i) {
+        uint64_t bit = (uint64_t)1 << i;
+        char ch = text[i];
+
+        if (ch == '\"')
+            block->quote |= bit;
+        else if (ch == '\\')
+            block->bslash |= bit;
+        else if (ch == ',')
+            block->comma |= bit;
+        else if ((ch | 0x20) == '{')
+            block->open |= bit;
+        else if ((ch | 0x20) == '}')
+            block->close |= bit;
+    }
+#endif
+}
+
+// bit i is the parity of the bits up to and including i
+static inline uint64_t json_prefix_xor(uint64_t mask) {
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+
+    return mask ^ mask << 32;
+}
+
+static inline unsigned json_popcount64(uint64_t x) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return (unsigned)__popcnt64(x);
+#else
+    return (unsigned)__builtin_popcountll(x);
+#endif
+}
+
+// string state carried from one block to the next
+typedef struct json_block_carry {
+    uint64_t in_string; // all ones when the last block ended in a string
+    uint64_t escaped; // bit 0 when the last block ended on a backslash
+} json_block_carry_t;
+
+// scans the block at index, padding past len with spaces, and strips its
+// brackets and commas down to the ones outside of strings. quotes which
+// aren't escaped toggle the string bytes
+static inline void json_read_block(
+    const char *text, size_t index, size_t len, json_block_t *block,
+    json_block_carry_t *carry
+) {
+    if (index + 64 <= len) {
+        json_scan_block(text + index, block);
+    } else {
+        char tail[64];
+
+        memset(tail, ' ', sizeof(tail));
+        memcpy(tail, text + index, len - index);
+        json_scan_block(tail, block);
+    }
+
+    // escaped backslashes don't escape what follows them
+    if (block->bslash || carry->escaped) {
+        uint64_t bslash = block->bslash, escaped = carry->escaped;
+
+        carry->escaped = 0;
+
+        while (bslash) {
+            uint64_t bit = bslash & -bslash;
+
+            bslash ^= bit;
+
+            if (bit & escaped)
+                continue;
+
+            if (bit >> 63)
+                carry->escaped = 1;
+            else
+                escaped |= bit << 1;
         }
+
+        block->quote &= ~escaped;
     }
 
-    return object;
+    // strings run from an opening quote up to its closing one
+    uint64_t outside = ~(carry->in_string ^ json_prefix_xor(block->quote));
+
+    block->open &= outside;
+    block->close &= outside;
+    block->comma &= outside;
+
+    carry->in_string = (uint64_t)0 - (~outside >> 63);
 }
 
 // parsing =====================================================================
 
+// deepest nesting of containers text may have, lazy loads included. parsing,
+// serializing, copying, forcing, images and tapes keep their open containers
+// on the heap instead of recursing, this just stops hostile json from using
+// unbounded memory
+#ifndef JSON_MAX_DEPTH
+#define JSON_MAX_DEPTH 1024
+#endif
+
 // for mapping escape sequences
 #define JSON_ESCAPE_CHARACTERS_X\
     X('"', '\"')\
@@ -654,41 +2101,28 @@ static json_object_t *json_hmap_del(
     X('r', '\r')\
     X('t', '\t')
 
-static bool json_is_whitespace(char ch) {
-    switch (ch) {
-    case 0x20:
-    case 0x0A:
-    case 0x0D:
-    case 0x09:
-        return true;
-    default:
-        return false;
-    }
-}
-
 static inline bool json_is_digit(char ch) {
     return ch >= '0' && ch <= '9';
 }
 
-// skip whitespace to start of next token
-static void json_next_token(json_ctx_t *ctx) {
-    while (1) {
-        if (!json_is_whitespace(ctx->text[ctx->index]))
-            return;
+// returns the current character, or '\0' past the end of the text
+static inline char json_peek(json_ctx_t *ctx) {
+    return ctx->index < ctx->len ? ctx->text[ctx->index] : '\0';
+}
 
-        ++ctx->index;
-    }
+// skip whitespace to start of next token
+static inline void json_next_token(json_ctx_t *ctx) {
+    ctx->index = json_skip_whitespace(ctx->text, ctx->index, ctx->len);
 }
 
 // compare next token with passed token
 static bool json_token_equals(
     json_ctx_t *ctx, const char *token, size_t length
 ) {
-    for (size_t i = 0; i < length; ++i)
-        if (ctx->text[ctx->index + i] != token[i])
-            return false;
+    if (ctx->len - ctx->index < length)
+        return false;
 
-    return true;
+    return !memcmp(ctx->text + ctx->index, token, length);
 }
 
 // error if next token does not equal passed token, otherwise skip
@@ -704,11 +2138,13 @@ static void json_expect_token(
 // error if next character is not a valid json string character, otherwise
 // return char and skip
 static char json_expect_str_char(json_ctx_t *ctx) {
-    if (ctx->text[ctx->index] == '\\') {
+    if (json_peek(ctx) == '\\') {
         // escape codes
         char ch;
 
-        switch (ctx->text[++ctx->index]) {
+        ++ctx->index;
+
+        switch (json_peek(ctx)) {
 #define X(a, b) case a: ch = b; break;
         JSON_ESCAPE_CHARACTERS_X
 #undef X
@@ -722,7 +2158,7 @@ static char json_expect_str_char(json_ctx_t *ctx) {
             JSON_CTX_ERROR(
                 ctx,
                 "unknown character escape: '%c' (%hhX)\n",
-                ctx->text[ctx->index], ctx->text[ctx->index]
+                json_peek(ctx), json_peek(ctx)
             );
         }
 
@@ -735,913 +2171,5624 @@ static char json_expect_str_char(json_ctx_t *ctx) {
     }
 }
 
-// return string allocated on ctx allocator if valid string, otherwise error
-static char *json_expect_string(json_ctx_t *ctx) {
-    // verify string and count string length
-    if (ctx->text[ctx->index++] != '\"')
-        JSON_CTX_ERROR(ctx, "unknown token, expected string.\n");
+// containers collect their children on the scratch stack while they're
+// parsed, so their storage can be allocated at its exact size once closed
+#define JSON_SCRATCH_INIT_CAP 4096
 
-    size_t start_index = ctx->index;
-    size_t length = 0;
+// grows *buf to hold at least size bytes by doubling *cap
+static void json_buf_reserve(
+    const json_allocator_t *allocator, char **buf, size_t *cap, size_t size
+) {
+    if (size <= *cap)
+        return;
 
-    while (ctx->text[ctx->index] != '\"') {
-        switch (ctx->text[ctx->index]) {
-        default:
-            json_expect_str_char(ctx);
-            ++length;
+    size_t new_cap = *cap ? *cap : JSON_SCRATCH_INIT_CAP;
 
-            break;
-        case '\n':
-        case '\0':
-            JSON_CTX_ERROR(ctx, "string ended unexpectedly.\n");
-        }
-    }
+    while (size > new_cap)
+        new_cap <<= 1;
 
-    // read string
-    char *str = (char *)json_page_alloc(ctx->json, (length + 1) * sizeof(*str));
+    *buf = (char *)(*buf
+        ? json_resize(allocator, *buf, *cap, new_cap)
+        : json_alloc(allocator, new_cap));
+    *cap = new_cap;
+}
 
-    ctx->index = start_index;
+// returns space for size bytes on top of the scratch stack without pushing it
+static inline void *json_scratch_reserve(json_ctx_t *ctx, size_t size) {
+    json_buf_reserve(
+        ctx->allocator,
+        &ctx->scratch,
+        &ctx->scratch_cap,
+        ctx->scratch_size + size
+    );
 
-    for (size_t i = 0; i < length; ++i)
-        str[i] = json_expect_str_char(ctx);
+    return ctx->scratch + ctx->scratch_size;
+}
 
-    str[length] = '\0';
+// returns space for size bytes pushed on top of the scratch stack. pushes are
+// all multiples of JSON_PAGE_ALIGN, so this is aligned for any of them
+static inline void *json_scratch_push(json_ctx_t *ctx, size_t size) {
+    void *ptr = json_scratch_reserve(ctx, size);
 
-    ++ctx->index; // skip ending double quote
+    ctx->scratch_size += size;
 
-    return str;
+    return ptr;
 }
 
-static double json_expect_number(json_ctx_t *ctx) {
-    size_t start_index = ctx->index;
+// return string allocated on ctx allocator if valid string, otherwise error.
+// also reports the decoded length, and the hash when out_hash is given
+static char *json_expect_string(
+    json_ctx_t *ctx, size_t *out_len, json_hash_t *out_hash
+) {
+    if (json_peek(ctx) != '\"')
+        JSON_CTX_ERROR(ctx, "unknown token, expected string.\n");
 
-    // minus symbol
-    if (ctx->text[ctx->index] == '-')
-        ++ctx->index;
+    ++ctx->index;
 
-    // integral component
-    if (!json_is_digit(ctx->text[ctx->index]))
-        JSON_CTX_ERROR(ctx, "expected digit.\n");
+    // verify string and count string length. when parsing in situ this also
+    // decodes the string, escapes only ever shrink the string so the write
+    // position can't overtake the read position
+    size_t start_index = ctx->index;
+    size_t length = 0;
+    char *str = ctx->insitu ? ctx->insitu + start_index : NULL;
 
-    while (json_is_digit(ctx->text[ctx->index])) {
-        ++ctx->index;
-    }
+    while (1) {
+        size_t run_index = ctx->index;
 
-    // fractional component
-    if (ctx->text[ctx->index] == '.') {
-        ++ctx->index;
+        ctx->index = json_scan_string(ctx->text, ctx->index, ctx->len);
 
-        if (!json_is_digit(ctx->text[ctx->index]))
-            JSON_CTX_ERROR(ctx, "expected digit.\n");
+        size_t run_length = ctx->index - run_index;
 
-        while (json_is_digit(ctx->text[ctx->index])) {
-            ++ctx->index;
-        }
-    }
+        if (str && str + length != ctx->insitu + run_index)
+            memmove(str + length, ctx->text + run_index, run_length);
 
-    // exponential component
-    if (ctx->text[ctx->index] == 'e' || ctx->text[ctx->index] == 'E') {
-        ++ctx->index;
+        length += run_length;
 
-        // read exponent
-        if (ctx->text[ctx->index] == '+' || ctx->text[ctx->index] == '-')
-            ++ctx->index;
+        // escape sequence, control character or end of string
+        switch (json_peek(ctx)) {
+        case '\"':
+            break;
+        case '\n':
+        case '\0':
+            JSON_CTX_ERROR(ctx, "string ended unexpectedly.\n");
+        default: {
+            char ch = json_expect_str_char(ctx);
 
-        if (!json_is_digit(ctx->text[ctx->index]))
-            JSON_CTX_ERROR(ctx, "expected digit.\n");
+            if (str)
+                str[length] = ch;
 
-        while (json_is_digit(ctx->text[ctx->index])) {
-            ++ctx->index;
+            ++length;
+
+            continue;
         }
+        }
+
+        break;
     }
 
-    // number is valid json and accepted, can parse
-    char buf[128];
-    size_t length = ctx->index - start_index;
-    strncpy(buf, &ctx->text[start_index], length);
+    // interned strings are decoded where they're transient, and only copied to
+    // the json_t the first time they're seen
+    bool intern = !str && ctx->intern && !ctx->transient
+        && (out_hash || length <= JSON_INTERN_MAX_LEN);
 
-    return atof(buf);
-}
+    if (!str) {
+        // read string
+        str = ctx->transient || intern
+            ? (char *)json_scratch_reserve(ctx, length + 1)
+            : json_page_alloc_str(ctx->json, length);
 
-static json_object_t *json_expect_obj(json_ctx_t *, json_object_t *);
-static json_object_t *json_expect_array(json_ctx_t *, json_object_t *);
+        if (length == ctx->index - start_index) {
+            // no escapes
+            memcpy(str, ctx->text + start_index, length);
+        } else {
+            size_t end_index = ctx->index;
+            size_t i = 0;
 
-// fills object in with value
-static void json_expect_value(json_ctx_t *ctx, json_object_t *object) {
-    switch (ctx->text[ctx->index]) {
-    case '{':
-        json_expect_obj(ctx, object);
-        object->type = JSON_OBJECT;
+            ctx->index = start_index;
 
-        break;
-    case '[':
-        json_expect_array(ctx, object);
-        object->type = JSON_ARRAY;
+            while (ctx->index < end_index) {
+                size_t run_index = ctx->index;
 
-        break;
-    case '"':
-        object->data.string = json_expect_string(ctx);
-        object->type = JSON_STRING;
+                ctx->index = json_scan_string(ctx->text, ctx->index, end_index);
+                memcpy(str + i, ctx->text + run_index, ctx->index - run_index);
+                i += ctx->index - run_index;
 
-        break;
-    case 't':
-        json_expect_token(ctx, "true", 4);
-        object->type = JSON_TRUE;
+                if (ctx->index < end_index)
+                    str[i++] = json_expect_str_char(ctx);
+            }
+        }
+    }
 
-        break;
-    case 'f':
-        json_expect_token(ctx, "false", 5);
-        object->type = JSON_FALSE;
+    str[length] = '\0';
 
-        break;
-    case 'n':
-        json_expect_token(ctx, "null", 4);
-        object->type = JSON_NULL;
+    ++ctx->index; // skip ending double quote
 
-        break;
-    default:;
-        // could be number
-        if (json_is_digit(ctx->text[ctx->index])
-         || ctx->text[ctx->index] == '-') {
-            object->data.number = json_expect_number(ctx);
-            object->type = JSON_NUMBER;
+    *out_len = length;
 
-            break;
-        }
+    // the decoded string is still in cache here
+    if (out_hash || intern) {
+        json_hash_t hash = json_hash_mem(str, length);
 
-        JSON_CTX_ERROR(ctx, "unknown token, expected value.\n");
+        if (out_hash)
+            *out_hash = hash;
+
+        if (intern)
+            str = json_intern_mem(ctx->json, str, length, hash);
     }
+
+    return str;
 }
 
-static json_object_t *json_expect_array(
-    json_ctx_t *ctx, json_object_t *object
-) {
-    json_vec_t *vec = (json_vec_t *)json_page_alloc(ctx->json, sizeof(*vec));
-    json_vec_make(ctx->json, vec, JSON_VEC_INIT_CAP);
+// numbers are accumulated into a 64 bit mantissa while they are validated.
+// when the mantissa and power of ten are both exact doubles a single multiply
+// or divide is correctly rounded (Clinger's fast path), everything else falls
+// back to strtod(). x87 style excess precision breaks the fast path
+#if !defined(FLT_EVAL_METHOD) || FLT_EVAL_METHOD == 0 || FLT_EVAL_METHOD == 1
+#define JSON_FAST_FLOAT
+#endif
 
-    object->data.vec = vec;
+#define JSON_MANTISSA_DIGITS 19 // digits that always fit in a uint64_t
+#define JSON_MAX_EXACT_INT ((uint64_t)1 << 53)
+#define JSON_MAX_EXACT_POW10 22
+#define JSON_MAX_EXPONENT 100000 // exponents are saturated past this
 
-    ++ctx->index; // skip '['
+static const double json_pow10[JSON_MAX_EXACT_POW10 + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13,
+    1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-    // check for empty array
-    json_next_token(ctx);
+// correctly rounded fallback. the number is rewritten without its decimal
+// point so that strtod()'s locale doesn't matter, long numbers are rewritten
+// into a buffer from allocator
+static double json_parse_double_slow(
+    const json_allocator_t *allocator, const char *text, size_t len
+) {
+    char stack_buf[128];
+    size_t buf_size = len + 16;
+    char *buf = buf_size <= sizeof(stack_buf)
+        ? stack_buf : (char *)json_alloc(allocator, buf_size);
 
-    if (ctx->text[ctx->index] == ']') {
-        ++ctx->index;
+    size_t i = 0, n = 0;
+    long exponent = 0;
 
-        return object;
-    }
+    if (text[i] == '-')
+        buf[n++] = text[i++];
 
-    // parse key/value pairs
-    while (1) {
-        // get child and store
-        json_object_t *child = (json_object_t *)json_page_alloc(
-            ctx->json,
-            sizeof(*child)
-        );
+    // copy digits, counting fractional digits into the exponent
+    bool fractional = false;
 
-        json_expect_value(ctx, child);
+    for (; i < len && text[i] != 'e' && text[i] != 'E'; ++i) {
+        if (text[i] == '.') {
+            fractional = true;
+        } else {
+            buf[n++] = text[i];
+            exponent -= fractional;
+        }
+    }
 
-        json_vec_push(ctx->json, vec, child);
+    // explicit exponent
+    if (i < len) {
+        bool negative = text[++i] == '-';
+        long explicit_exponent = 0;
 
-        // iterate
-        json_next_token(ctx);
+        if (text[i] == '-' || text[i] == '+')
+            ++i;
 
-        if (ctx->text[ctx->index] == ']') {
-            ++ctx->index;
-            break;
-        }
+        for (; i < len; ++i)
+            if (explicit_exponent < JSON_MAX_EXPONENT)
+                explicit_exponent = explicit_exponent * 10 + (text[i] - '0');
 
-        json_expect_token(ctx, ",", 1);
-        json_next_token(ctx);
+        exponent += negative ? -explicit_exponent : explicit_exponent;
     }
 
-    return object;
-}
+    sprintf(buf + n, "e%ld", exponent);
 
-static json_object_t *json_expect_obj(json_ctx_t *ctx, json_object_t *object) {
-    json_hmap_t *hmap = (json_hmap_t *)json_page_alloc(
-        ctx->json,
-        sizeof(*hmap)
-    );
-    json_hmap_make(ctx->json, hmap, JSON_HMAP_INIT_CAP);
+    double value = strtod(buf, NULL);
 
-    object->data.hmap = hmap;
+    if (buf != stack_buf)
+        json_release(allocator, buf, buf_size);
 
-    ++ctx->index; // skip '{'
+    return value;
+}
 
-    // check for empty object
-    json_next_token(ctx);
+// fills object in with a number. integers without a fraction or exponent which
+// fit in an int64_t are stored exactly
+static void json_expect_number(json_ctx_t *ctx, json_object_t *object) {
+    size_t start_index = ctx->index;
+    uint64_t mantissa = 0;
+    int num_digits = 0; // significant digits in mantissa
+    int exponent = 0;
+    bool negative = false;
+    bool integral = true; // no fraction or exponent
+    bool truncated = false; // nonzero digits didn't fit in mantissa
+    char ch;
 
-    if (ctx->text[ctx->index] == '}') {
+    // minus symbol
+    if (json_peek(ctx) == '-') {
+        negative = true;
         ++ctx->index;
-
-        return object;
     }
 
-    // parse key/value pairs
-    while (1) {
-        // get pair and store
-        json_object_t *child = (json_object_t *)json_page_alloc(
-            ctx->json,
-            sizeof(*object)
-        );
+    // integral component
+    if (!json_is_digit(json_peek(ctx)))
+        JSON_CTX_ERROR(ctx, "expected digit.\n");
 
-        char *key = json_expect_string(ctx);
+    while (json_is_digit(ch = json_peek(ctx))) {
+        if (num_digits < JSON_MANTISSA_DIGITS) {
+            mantissa = mantissa * 10 + (uint64_t)(ch - '0');
+            num_digits += mantissa != 0;
+        } else {
+            truncated |= ch != '0';
+            ++exponent;
+        }
 
-        json_next_token(ctx);
-        json_expect_token(ctx, ":", 1);
-        json_next_token(ctx);
-        json_expect_value(ctx, child);
+        ++ctx->index;
+    }
 
-        json_hmap_put(ctx->json, hmap, key, child);
+    // fractional component
+    if (json_peek(ctx) == '.') {
+        integral = false;
+        ++ctx->index;
 
-        // iterate
-        json_next_token(ctx);
+        if (!json_is_digit(json_peek(ctx)))
+            JSON_CTX_ERROR(ctx, "expected digit.\n");
+
+        while (json_is_digit(ch = json_peek(ctx))) {
+            if (num_digits < JSON_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + (uint64_t)(ch - '0');
+                num_digits += mantissa != 0;
+                --exponent;
+            } else {
+                truncated |= ch != '0';
+            }
 
-        if (ctx->text[ctx->index] == '}') {
             ++ctx->index;
-            break;
         }
-
-        json_expect_token(ctx, ",", 1);
-        json_next_token(ctx);
     }
 
-    return object;
-}
+    // exponential component
+    if (json_peek(ctx) == 'e' || json_peek(ctx) == 'E') {
+        integral = false;
+        ++ctx->index;
 
-static void json_parse(json_t *json, const char *text) {
-    json_ctx_t ctx;
+        // read exponent
+        bool exp_negative = json_peek(ctx) == '-';
+        int explicit_exponent = 0;
 
-    ctx.json = json;
-    ctx.text = text;
-    ctx.index = 0;
+        if (json_peek(ctx) == '+' || json_peek(ctx) == '-')
+            ++ctx->index;
 
-    // recursive parse at root
-    json_next_token(&ctx);
+        if (!json_is_digit(json_peek(ctx)))
+            JSON_CTX_ERROR(ctx, "expected digit.\n");
 
-    switch (ctx.text[ctx.index]) {
-    case '{':
-        json->root = (json_object_t *)json_page_alloc(
-            ctx.json,
-            sizeof(*json->root)
-        );
+        while (json_is_digit(ch = json_peek(ctx))) {
+            if (explicit_exponent < JSON_MAX_EXPONENT)
+                explicit_exponent = explicit_exponent * 10 + (ch - '0');
 
-        json_expect_obj(&ctx, json->root);
-        json->root->type = JSON_OBJECT;
+            ++ctx->index;
+        }
 
-        json_next_token(&ctx);
-        json_expect_token(&ctx, "", 1);
+        exponent += exp_negative ? -explicit_exponent : explicit_exponent;
+    }
 
-        break;
-    case '[':
-        json->root = (json_object_t *)json_page_alloc(
-            ctx.json,
-            sizeof(*json->root)
-        );
+    // number is valid json and accepted, can convert
+    object->type = JSON_NUMBER;
+    // -0 stays a double to keep its sign
+    object->is_int = integral && exponent == 0 && (mantissa || !negative)
+        && mantissa <= (uint64_t)INT64_MAX + negative;
 
-        json_expect_array(&ctx, json->root);
-        json->root->type = JSON_ARRAY;
+    if (object->is_int) {
+        object->data.integer = negative
+            ? (int64_t)(0 - mantissa) : (int64_t)mantissa;
 
-        json_next_token(&ctx);
-        json_expect_token(&ctx, "", 1);
+        return;
+    }
 
-        break;
-    case '\0': // empty json is still valid json
-        json->root = NULL;
+    if (!mantissa) {
+        object->data.number = negative ? -0.0 : 0.0;
 
-        break;
-    default:
-        JSON_CTX_ERROR(&ctx, "invalid json root.\n");
+        return;
     }
-}
-
-// lifetime api ================================================================
 
-void json_load_empty(json_t *json) {
-    json->root = NULL;
+#ifdef JSON_FAST_FLOAT
+    if (!truncated) {
+        // trade exponent for mantissa digits while the mantissa stays exact
+        while (exponent > JSON_MAX_EXACT_POW10
+            && mantissa <= JSON_MAX_EXACT_INT / 10) {
+            mantissa *= 10;
+            --exponent;
+        }
 
-    // page allocator
-    json->cur_page = json->used = 0;
-    json->page_cap = JSON_INIT_PAGE_CAP;
-    json->pages = (char **)json_fat_alloc(
-        json->page_cap * sizeof(*json->pages)
-    );
+        if (mantissa <= JSON_MAX_EXACT_INT
+         && exponent >= -JSON_MAX_EXACT_POW10
+         && exponent <= JSON_MAX_EXACT_POW10) {
+            double value = (double)mantissa;
 
-    json->pages[0] = (char *)JSON_MALLOC(JSON_PAGE_SIZE);
+            if (exponent < 0)
+                value /= json_pow10[-exponent];
+            else
+                value *= json_pow10[exponent];
 
-    // tracking allocator
-    json->cur_tracked = 0;
-    json->tracked_cap = JSON_INIT_TRACKED_CAP;
-    json->tracked = (json_tptr_t **)json_fat_alloc(
-        json->tracked_cap * sizeof(*json->tracked)
-    );
+            object->data.number = negative ? -value : value;
 
-    JSON_DEBUG("tracked size %zu.\n", *((size_t *)json->tracked - 1));
+            return;
+        }
+    }
+#endif
 
-    for (size_t i = 0; i < json->tracked_cap; ++i)
-        json->tracked[i] = NULL;
+    object->data.number = json_parse_double_slow(
+        ctx->allocator,
+        ctx->text + start_index,
+        ctx->index - start_index
+    );
 }
 
-static void json_parse(json_t *json, const char *text);
-
-void json_load(json_t *json, char *text) {
-    json_load_empty(json);
-    json_parse(json, text);
-}
+static void json_expect_obj(json_ctx_t *, json_object_t *);
+static void json_expect_array(json_ctx_t *, json_object_t *);
+
+// a container of a JSON_LOAD_LAZY text. its children are the nodes after it,
+// up to next
+typedef struct json_lazy_node {
+    size_t start, end; // brackets included
+    size_t next;
+} json_lazy_node_t;
+
+// finds every container of the root at ctx->index in one pass, so that
+// forcing a container never scans the text of its children. only counts
+// brackets, mismatched ones are left for the parser
+static void json_index_containers(json_ctx_t *ctx) {
+    json_block_carry_t carry = {0, 0};
+    size_t base = ctx->scratch_size;
+    size_t count = 0, depth = 0;
+    size_t open = SIZE_MAX; // innermost open node, its next is its parent
+
+    for (size_t index = ctx->index; index < ctx->len; index += 64) {
+        json_block_t block;
+
+        json_read_block(ctx->text, index, ctx->len, &block, &carry);
+
+        for (uint64_t bits = block.open | block.close; bits; bits &= bits - 1) {
+            uint64_t bit = bits & -bits;
+            size_t at = index + json_ctz64(bit);
+            json_lazy_node_t *node;
+
+            if (bit & block.open) {
+                if (depth++ == JSON_MAX_DEPTH) {
+                    ctx->index = at;
+                    JSON_CTX_ERROR_CODE(
+                        ctx,
+                        JSON_ERR_DEPTH,
+                        "json nested deeper than JSON_MAX_DEPTH.\n"
+                    );
+                }
+
+                node = (json_lazy_node_t *)json_scratch_push(
+                    ctx,
+                    sizeof(*node)
+                );
+                node->start = at;
+                node->next = open;
+                open = count++;
 
-void json_load_file(json_t *json, const char *filepath) {
-    JSON_DEBUG("reading\n");
+                continue;
+            }
 
-    // open and check for existance
-    FILE *file = fopen(filepath, "r");
+            node = (json_lazy_node_t *)(ctx->scratch + base) + open;
+            node->end = at + 1;
+            open = node->next;
+            node->next = count;
 
-    if (!file)
-        JSON_ERROR("could not open file: \"%s\"\n", filepath);
+            if (--depth)
+                continue;
 
-    // read text through buffer
-    char *text = NULL;
-    char *buffer = (char *)JSON_MALLOC(JSON_FREAD_BUF_SIZE);
-    size_t text_len = 0;
-    bool done = false;
+            // move the nodes to the json_t, spans point at them
+            json_lazy_node_t *nodes = (json_lazy_node_t *)json_page_alloc(
+                ctx->json,
+                count * sizeof(*nodes)
+            );
 
-    do {
-        size_t num_read = fread(
-            buffer,
-            sizeof(*buffer),
-            JSON_FREAD_BUF_SIZE,
-            file
-        );
+            memcpy(nodes, ctx->scratch + base, count * sizeof(*nodes));
+            ctx->scratch_size = base;
+            ctx->nodes = nodes;
+            ctx->node = 0;
+            ctx->node_end = count;
 
-        if (num_read != JSON_FREAD_BUF_SIZE) {
-            done = true;
-            ++num_read;
+            return;
         }
+    }
 
-        // copy buffer into doc->text
-        size_t last_len = text_len;
+    JSON_CTX_ERROR(ctx, "json ended unexpectedly.\n");
+}
 
-        text_len += num_read;
-        text = (char *)json_fat_realloc(text, text_len);
+// container of a JSON_LOAD_LAZY load which hasn't been parsed yet
+typedef struct json_span {
+    json_t *json; // by address, which is why a lazy json_t can't be moved
+    const char *text;
+    const json_lazy_node_t *nodes;
+    size_t node;
+    unsigned flags;
+} json_span_t;
 
-        memcpy(text + last_len, buffer, num_read * sizeof(*buffer));
-    } while (!done);
+// skips over the container at ctx->index, leaving it for json_force()
+static void json_expect_span(json_ctx_t *ctx, json_object_t *object) {
+    const json_lazy_node_t *node = ctx->nodes + ctx->node;
 
-    text[text_len - 1] = '\0';
+    // the brackets were miscounted, the parser stopping in between is the
+    // only way for this to happen
+    if (ctx->node == ctx->node_end || node->start != ctx->index)
+        JSON_CTX_ERROR(ctx, "mismatched brackets.\n");
 
-    free(buffer);
+    json_span_t *span = (json_span_t *)json_page_alloc(
+        ctx->json,
+        sizeof(*span)
+    );
 
-    // load and cleanup
-    JSON_DEBUG("loading\n");
+    span->json = ctx->json;
+    span->text = ctx->text;
+    span->nodes = ctx->nodes;
+    span->node = ctx->node;
+    span->flags = JSON_LOAD_LAZY | (ctx->insitu ? JSON_LOAD_INSITU : 0)
+        | (ctx->intern ? JSON_LOAD_INTERN : 0);
 
-    json_load(json, text);
+    object->data.span = span;
+    object->is_lazy = true;
+    object->is_image = false;
 
-    json_fat_free(text);
-    fclose(file);
+    ctx->index = node->end;
+    ctx->node = node->next;
 }
 
-// recursively free object hashmap and array vectors
-void json_unload(json_t *json) {
-    // free pages
-    for (size_t i = 0; i <= json->cur_page; ++i)
-        JSON_FREE(json->pages[i]);
+// fills object in with value
+static void json_expect_value(json_ctx_t *ctx, json_object_t *object) {
+    object->is_int = false;
+    object->is_lazy = false;
 
-    json_fat_free(json->pages);
+    switch (json_peek(ctx)) {
+    case '{':
+        if (ctx->lazy)
+            json_expect_span(ctx, object);
+        else
+            json_expect_obj(ctx, object);
 
-    // free tracked
-    for (size_t i = 0; i <= json->cur_tracked; ++i)
-        if (json->tracked[i])
-            JSON_FREE(json->tracked[i]);
+        object->type = JSON_OBJECT;
 
-    json_fat_free(json->tracked);
-}
+        break;
+    case '[':
+        if (ctx->lazy)
+            json_expect_span(ctx, object);
+        else
+            json_expect_array(ctx, object);
 
-// serialization api ===========================================================
+        object->type = JSON_ARRAY;
 
-// same as JSON_ESCAPE_CHARACTERS_X but without solidus ('/') as it is not required to be escaped
-#define JSON_SERIALIZE_ESCAPE_CHARACTERS_X\
-    X('"', '\"')\
-    X('\\', '\\')\
-    X('b', '\b')\
-    X('f', '\f')\
-    X('n', '\n')\
-    X('r', '\r')\
-    X('t', '\t')
+        break;
+    case '"': {
+        size_t length;
 
-#ifndef JSON_SERIALIZER_BUF_SIZE
-#define JSON_SERIALIZER_BUF_SIZE 1024
-#endif
+        object->data.string = json_expect_string(ctx, &length, NULL);
+        object->type = JSON_STRING;
 
-#define JSON_STRINGY_INIT_CAP 256
+        break;
+    }
+    case 't':
+        json_expect_token(ctx, "true", 4);
+        object->type = JSON_TRUE;
 
-// string builder
-typedef struct json_stringy {
-    char *str;
-    size_t pos, cap;
-} json_stringy_t;
+        break;
+    case 'f':
+        json_expect_token(ctx, "false", 5);
+        object->type = JSON_FALSE;
 
-// serialization context
-typedef struct json_serializer {
-    json_stringy_t stringy;
-    char *buf;
-    int level;
+        break;
+    case 'n':
+        json_expect_token(ctx, "null", 4);
+        object->type = JSON_NULL;
 
-    int indent, nlwidth;
-    bool mini;
-} json_serializer_t;
+        break;
+    default:;
+        // could be number
+        if (json_is_digit(json_peek(ctx))
+         || json_peek(ctx) == '-') {
+            json_expect_number(ctx, object);
 
-static void json_stringy_make(json_stringy_t *stringy) {
-    stringy->cap = JSON_STRINGY_INIT_CAP;
-    stringy->str = (char *)json_fat_alloc(stringy->cap);
-    stringy->pos = 0;
-}
+            break;
+        }
 
-static inline void json_stringy_kill(json_stringy_t *stringy) {
-    json_fat_free(stringy->str);
+        JSON_CTX_ERROR(ctx, "unknown token, expected value.\n");
+    }
 }
 
-static void json_stringy_append(
-    json_stringy_t *stringy, const char *str, size_t len
+// pending object entry
+typedef struct json_scratch_entry {
+    json_hash_t hash;
+    size_t len;
+    char *key;
+    json_object_t value;
+} json_scratch_entry_t;
+
+// makes a vec holding copies of size values
+static json_vec_t *json_vec_build(
+    json_t *json, const json_object_t *values, size_t size
 ) {
-    if (stringy->pos + len >= stringy->cap) {
-        stringy->cap <<= 1;
-        stringy->str = (char *)json_fat_realloc(
-            stringy->str,
-            stringy->cap * sizeof(*stringy->str)
-        );
-    }
+    json_object_t *children;
+    json_vec_t *vec = json_vec_alloc(json, size, &children);
 
-    // extra parens here suppress an unnecessary gcc warning
-    (strncpy(stringy->str + stringy->pos, str, len));
+    if (size)
+        memcpy(children, values, size * sizeof(*children));
 
-    stringy->pos += len;
+    return vec;
 }
 
-static void json_serialize_string(json_serializer_t *ser_ctx, char *str) {
-    json_stringy_append(&ser_ctx->stringy, "\"", 1);
-
-    while (*str) {
-        switch (*str) {
-#define X(a, b)\
-        case b:\
-            sprintf(ser_ctx->buf, "\\%c", a);\
-            json_stringy_append(&ser_ctx->stringy, ser_ctx->buf, 2);\
-            break;
+// makes a map from size entries, duplicate keys keep their first position and
+// take the last value
+static json_hmap_t *json_hmap_build(
+    json_t *json, const json_scratch_entry_t *entries, size_t size
+) {
+    json_object_t *values;
+    json_hmap_t *hmap = json_hmap_alloc(json, size, &values);
+
+    for (size_t i = 0; i < size; ++i) {
+        const json_scratch_entry_t *entry = &entries[i];
+        ptrdiff_t found = json_hmap_find(
+            hmap,
+            entry->key,
+            entry->len,
+            entry->hash
+        );
 
-        JSON_SERIALIZE_ESCAPE_CHARACTERS_X
-#undef X
-        default:
-            json_stringy_append(&ser_ctx->stringy, str, 1);\
-            break;
+        if (found >= 0) {
+            *hmap->objects[found] = entry->value;
+            continue;
         }
 
-        ++str;
+        json_object_t *value = &values[hmap->size];
+
+        *value = entry->value;
+
+        json_hmap_append(
+            json,
+            hmap,
+            entry->key,
+            entry->len,
+            entry->hash,
+            value
+        );
     }
 
-    json_stringy_append(&ser_ctx->stringy, "\"", 1);
+    return hmap;
 }
 
-static inline void json_serialize_indent(json_serializer_t *ser_ctx) {
-    if (!ser_ctx->mini) {
-        int indent = ser_ctx->level * ser_ctx->indent;
-
-        sprintf(ser_ctx->buf, "%*s", indent, "");
-        json_stringy_append(&ser_ctx->stringy, ser_ctx->buf, indent);
+// container opened by json_expect_children(), its children are pushed above
+// it. entry is what it'll be pushed as once it closes
+typedef struct json_scratch_frame {
+    json_scratch_entry_t entry;
+    size_t parent; // offset of the enclosing frame
+    char close; // of the enclosing container
+    bool members;
+} json_scratch_frame_t;
+
+// pushes a finished child, a whole entry for objects or just its value
+static inline void json_scratch_child(
+    json_ctx_t *ctx, const json_scratch_entry_t *entry, bool members
+) {
+    if (members) {
+        *(json_scratch_entry_t *)json_scratch_push(ctx, sizeof(*entry)) = *entry;
+    } else {
+        *(json_object_t *)json_scratch_push(ctx, sizeof(entry->value)) =
+            entry->value;
     }
 }
 
-static void json_serialize_array(json_serializer_t *, json_object_t *);
-static void json_serialize_obj(json_serializer_t *, json_object_t *);
+// pushes comma separated values, or key/value pairs for members, onto the
+// scratch stack until close. the ranges of a split root end on a close of
+// '\0', the end of their text.
+// nested containers are parsed in the same loop instead of recursing so that
+// deep json can't overflow the stack. each one is a frame on the scratch stack
+// under its children, which are built into a block when it closes
+static void json_expect_children(json_ctx_t *ctx, char close, bool members) {
+    size_t depth = 1, frame = 0;
 
-static void json_serialize_value(
-    json_serializer_t *ser_ctx, json_object_t *object
-) {
-    switch (object->type) {
-    case JSON_OBJECT:
-        json_serialize_obj(ser_ctx, object);
+    while (1) {
+        json_scratch_entry_t entry;
 
-        break;
-    case JSON_ARRAY:
-        json_serialize_array(ser_ctx, object);
+        if (members) {
+            entry.key = json_expect_string(ctx, &entry.len, &entry.hash);
 
-        break;
-    case JSON_STRING:
-        json_serialize_string(ser_ctx, object->data.string);
+            json_next_token(ctx);
+            json_expect_token(ctx, ":", 1);
+            json_next_token(ctx);
+        }
 
-        break;
-    case JSON_NUMBER:
-        if ((long)object->data.number == object->data.number)
-            sprintf(ser_ctx->buf, "%ld", (long)object->data.number);
-        else
-            sprintf(ser_ctx->buf, "%lf", object->data.number);
-
-        json_stringy_append(
-            &ser_ctx->stringy,
-            ser_ctx->buf,
-            strlen(ser_ctx->buf)
-        );
-
-        break;
-    case JSON_TRUE:
-        json_stringy_append(&ser_ctx->stringy, "true", 4);
-
-        break;
-    case JSON_FALSE:
-        json_stringy_append(&ser_ctx->stringy, "false", 5);
-
-        break;
-    case JSON_NULL:
-        json_stringy_append(&ser_ctx->stringy, "null", 4);
-
-        break;
-    }
-}
+        char ch = json_peek(ctx);
 
-static void json_serialize_array(
-    json_serializer_t *ser_ctx, json_object_t *object
-) {
-    json_stringy_append(&ser_ctx->stringy, "[\n", ser_ctx->nlwidth);
+        if ((ch == '{' || ch == '[') && !ctx->lazy) {
+            if (++depth > JSON_MAX_DEPTH) {
+                JSON_CTX_ERROR_CODE(
+                    ctx,
+                    JSON_ERR_DEPTH,
+                    "json nested deeper than JSON_MAX_DEPTH.\n"
+                );
+            }
 
-    ++ser_ctx->level;
+            size_t offset = ctx->scratch_size;
+            json_scratch_frame_t *opened = (json_scratch_frame_t *)
+                json_scratch_push(ctx, sizeof(*opened));
 
-    for (size_t i = 0; i < object->data.vec->size; ++i) {
-        if (i)
-            json_stringy_append(&ser_ctx->stringy, ",\n", ser_ctx->nlwidth);
+            opened->entry = entry;
+            opened->parent = frame;
+            opened->close = close;
+            opened->members = members;
 
-        json_serialize_indent(ser_ctx);
-        json_serialize_value(
-            ser_ctx,
-            (json_object_t *)object->data.vec->data[i]
-        );
-    }
+            frame = offset;
+            close = ch == '{' ? '}' : ']';
+            members = ch == '{';
 
-    if (!ser_ctx->mini)
-        json_stringy_append(&ser_ctx->stringy, "\n", 1);
+            ++ctx->index;
+            json_next_token(ctx);
 
-    --ser_ctx->level;
+            if (json_peek(ctx) != close)
+                continue;
+        } else {
+            json_expect_value(ctx, &entry.value);
+            json_scratch_child(ctx, &entry, members);
+            json_next_token(ctx);
+        }
 
-    json_serialize_indent(ser_ctx);
-    json_stringy_append(&ser_ctx->stringy, "]", 1);
-}
+        // close every container ending here, the outermost is left to the
+        // caller
+        while (json_peek(ctx) == close) {
+            if (depth == 1)
+                return;
 
-static void json_serialize_obj(
-    json_serializer_t *ser_ctx, json_object_t *object
-) {
-    json_stringy_append(&ser_ctx->stringy, "{\n", ser_ctx->nlwidth);
+            ++ctx->index;
 
-    ++ser_ctx->level;
+            json_scratch_frame_t closed =
+                *(json_scratch_frame_t *)(ctx->scratch + frame);
+            char *children = ctx->scratch + frame + sizeof(closed);
+            size_t size = ctx->scratch_size - frame - sizeof(closed);
+
+            entry = closed.entry;
+            entry.value.is_int = false;
+            entry.value.is_lazy = false;
+
+            if (members) {
+                entry.value.type = JSON_OBJECT;
+                entry.value.data.hmap = json_hmap_build(
+                    ctx->json,
+                    (json_scratch_entry_t *)children,
+                    size / sizeof(json_scratch_entry_t)
+                );
+            } else {
+                entry.value.type = JSON_ARRAY;
+                entry.value.data.vec = json_vec_build(
+                    ctx->json,
+                    (json_object_t *)children,
+                    size / sizeof(json_object_t)
+                );
+            }
 
-    json_hmap_t *hmap = object->data.hmap;
-    json_vec_t *vec = &hmap->vec;
+            ctx->scratch_size = frame;
+            frame = closed.parent;
+            close = closed.close;
+            members = closed.members;
+            --depth;
 
-    for (size_t i = 0; i < vec->size; ++i) {
-        if (i) {
-            json_stringy_append(&ser_ctx->stringy, ",\n", ser_ctx->nlwidth);
+            json_scratch_child(ctx, &entry, members);
+            json_next_token(ctx);
         }
 
-        json_serialize_indent(ser_ctx);
-        json_serialize_string(ser_ctx, (char *)vec->data[i]);
-        json_stringy_append(&ser_ctx->stringy, ": ", ser_ctx->nlwidth);
-
-        json_serialize_value(
-            ser_ctx,
-            json_hmap_get(hmap, (char *)vec->data[i])
-        );
+        json_expect_token(ctx, ",", 1);
+        json_next_token(ctx);
     }
-
-    if (!ser_ctx->mini)
-        json_stringy_append(&ser_ctx->stringy, "\n", 1);
-
-    --ser_ctx->level;
-
-    json_serialize_indent(ser_ctx);
-    json_stringy_append(&ser_ctx->stringy, "}", 1);
 }
 
-char *json_serialize(
-    json_object_t *object, bool mini, int indent, size_t *out_len
-) {
-    if (!object)
-        JSON_ERROR("attempted to serialize a NULL object.\n");
-
-    // create and use serializer
-    json_serializer_t ser_ctx;
+static void json_expect_array(json_ctx_t *ctx, json_object_t *object) {
+    size_t base = ctx->scratch_size;
 
-    json_stringy_make(&ser_ctx.stringy);
+    ++ctx->index; // skip '['
 
-    ser_ctx.buf = (char *)JSON_MALLOC(JSON_SERIALIZER_BUF_SIZE);
-    ser_ctx.level = 0;
-    ser_ctx.indent = indent;
-    ser_ctx.mini = mini;
-    ser_ctx.nlwidth = ser_ctx.mini ? 1 : 2;
+    // check for empty array
+    json_next_token(ctx);
 
-    json_serialize_value(&ser_ctx, object);
-    json_stringy_append(&ser_ctx.stringy, "\n", 2);
+    if (json_peek(ctx) != ']')
+        json_expect_children(ctx, ']', false);
 
-    JSON_FREE(ser_ctx.buf);
+    ++ctx->index; // skip ']'
 
-    // return serialized string
-    size_t len = ser_ctx.stringy.pos;
-    char *serialized = (char *)JSON_MALLOC((len + 1) * sizeof(*serialized));
+    // move children to their final block
+    object->data.vec = json_vec_build(
+        ctx->json,
+        (json_object_t *)(ctx->scratch + base),
+        (ctx->scratch_size - base) / sizeof(json_object_t)
+    );
 
-    if (out_len)
-        *out_len = len;
+    ctx->scratch_size = base;
+}
 
-    strcpy(serialized, ser_ctx.stringy.str);
-    json_stringy_kill(&ser_ctx.stringy);
+static void json_expect_obj(json_ctx_t *ctx, json_object_t *object) {
+    size_t base = ctx->scratch_size;
 
-    return serialized;
-}
+    ++ctx->index; // skip '{'
 
-// get/put/to api functions ====================================================
+    // check for empty object
+    json_next_token(ctx);
 
-#define JSON_ASSERT_PROPER_CAST(json_type)\
-    JSON_ASSERT(\
-        object->type == json_type,\
-        "attempted to cast %s to %s.\n",\
-        json_types[object->type], json_types[json_type]\
-    )
+    if (json_peek(ctx) != '}')
+        json_expect_children(ctx, '}', true);
 
-static inline json_object_t *json_empty_object(json_t *json) {
-    return (json_object_t *)json_page_alloc(json, sizeof(json_object_t));
-}
+    ++ctx->index; // skip '}'
 
-json_object_t *json_get_object(json_object_t *object, char *key) {
-    JSON_ASSERT(
-        object->type == JSON_OBJECT,
-        "attempted to get child \"%s\" from a non-object.\n",
-        key
+    // move entries to their final block
+    object->data.hmap = json_hmap_build(
+        ctx->json,
+        (json_scratch_entry_t *)(ctx->scratch + base),
+        (ctx->scratch_size - base) / sizeof(json_scratch_entry_t)
     );
 
-    return json_hmap_get(object->data.hmap, key);
+    ctx->scratch_size = base;
 }
 
-json_object_t **json_get_array(
-    json_object_t *object, char *key, size_t *out_size
+// parse context for json, borrowing its scratch stack until json_ctx_done()
+static void json_ctx_make(
+    json_ctx_t *ctx, json_t *json, const char *text, size_t len, unsigned flags
 ) {
-    return json_to_array(json_get_object(object, key), out_size);
+    ctx->json = json;
+    ctx->text = text;
+    ctx->insitu = flags & JSON_LOAD_INSITU ? (char *)text : NULL;
+    ctx->index = 0;
+    ctx->len = len;
+    ctx->allocator = &json->allocator;
+    ctx->scratch = json->scratch;
+    ctx->scratch_size = 0;
+    ctx->scratch_cap = json->scratch_cap;
+    ctx->transient = false;
+    ctx->lazy = flags & JSON_LOAD_LAZY;
+    ctx->nodes = NULL;
+    ctx->node = ctx->node_end = 0;
+    ctx->intern = (flags & JSON_LOAD_INTERN) && !ctx->insitu;
+    ctx->error = NULL;
+    ctx->jmp = NULL;
 }
 
-char *json_get_string(json_object_t *object, char *key) {
-    return json_to_string(json_get_object(object, key));
+// a ctx for scanning text without a json_t, strings are transient
+static void json_ctx_make_bare(json_ctx_t *ctx, const char *text, size_t len) {
+    ctx->json = NULL;
+    ctx->text = text;
+    ctx->insitu = NULL;
+    ctx->index = 0;
+    ctx->len = len;
+    ctx->allocator = &json_default_allocator;
+    ctx->scratch = NULL;
+    ctx->scratch_size = 0;
+    ctx->scratch_cap = 0;
+    ctx->transient = true;
+    ctx->lazy = false;
+    ctx->nodes = NULL;
+    ctx->node = ctx->node_end = 0;
+    ctx->intern = false;
+    ctx->error = NULL;
+    ctx->jmp = NULL;
 }
 
-double json_get_number(json_object_t *object, char *key) {
-    return json_to_number(json_get_object(object, key));
+static void json_ctx_done(json_ctx_t *ctx) {
+    ctx->json->scratch = ctx->scratch;
+    ctx->json->scratch_cap = ctx->scratch_cap;
 }
 
-bool json_get_bool(json_object_t *object, char *key) {
-    return json_to_bool(json_get_object(object, key));
-}
+// parses a lazy container one level deep, its children stay lazy
+static void json_force_span(json_object_t *object) {
+    json_span_t *span = object->data.span;
+    const json_lazy_node_t *node = span->nodes + span->node;
+    json_ctx_t ctx;
 
-char **json_get_keys(json_object_t *object, size_t *out_size) {
-    json_hmap_t *hmap = object->data.hmap;
+    json_ctx_make(&ctx, span->json, span->text, node->end, span->flags);
+    ctx.index = node->start;
+    ctx.nodes = span->nodes;
+    ctx.node = span->node + 1;
+    ctx.node_end = node->next;
 
-    if (out_size)
-        *out_size = hmap->vec.size;
+    if (object->type == JSON_OBJECT)
+        json_expect_obj(&ctx, object);
+    else
+        json_expect_array(&ctx, object);
 
-    return (char **)hmap->vec.data;
-}
+    object->is_lazy = false;
 
-json_object_t **json_to_array(json_object_t *object, size_t *out_size) {
-    JSON_ASSERT_PROPER_CAST(JSON_ARRAY);
+    json_ctx_done(&ctx);
+}
 
-    json_vec_t *vec = object->data.vec;
+static void json_force_image(json_object_t *);
 
-    if (out_size)
-        *out_size = vec->size;
+// makes sure a container is parsed before its data is used
+static inline json_object_t *json_force(json_object_t *object) {
+    if (object->is_lazy) {
+        if (object->is_image)
+            json_force_image(object);
+        else
+            json_force_span(object);
+    }
 
-    return (json_object_t **)vec->data;
+    return object;
 }
 
-char *json_to_string(json_object_t *object) {
-    JSON_ASSERT_PROPER_CAST(JSON_STRING);
+// parses the root container at ctx->index, returns NULL at the end of the text
+static json_object_t *json_parse_root(json_ctx_t *ctx) {
+    char ch = json_peek(ctx);
 
-    return object->data.string;
-}
+    // empty json is still valid json
+    if (ch == '\0')
+        return NULL;
 
-double json_to_number(json_object_t *object) {
-    JSON_ASSERT_PROPER_CAST(JSON_NUMBER);
+    if (ch != '{' && ch != '[')
+        JSON_CTX_ERROR(ctx, "invalid json root.\n");
 
-    return object->data.number;
-}
+    if (ctx->lazy)
+        json_index_containers(ctx);
 
-bool json_to_bool(json_object_t *object) {
-    JSON_ASSERT(
-        object->type == JSON_TRUE || object->type == JSON_FALSE,
-        "attempted to cast %s to bool.\n",
-        json_types[object->type]
+    json_object_t *root = (json_object_t *)json_page_alloc(
+        ctx->json,
+        sizeof(*root)
     );
 
-    return object->type == JSON_TRUE;
+    json_expect_value(ctx, root);
+
+    return root;
 }
 
-json_object_t *json_pop(json_t *json, json_object_t *object, char *key) {
-    return json_hmap_del(json, object->data.hmap, key, false);
+// parses the whole text as one document
+static void json_parse_document(json_ctx_t *ctx) {
+    // recursive parse at root
+    json_next_token(ctx);
+    ctx->json->root = json_parse_root(ctx);
+
+    // only whitespace may follow the root
+    json_next_token(ctx);
+
+    if (ctx->index != ctx->len)
+        JSON_CTX_ERROR(ctx, "unexpected text after json root.\n");
 }
 
-json_object_t *json_pop_ordered(
-    json_t *json, json_object_t *object, char *key
+static void json_parse(
+    json_t *json, const char *text, size_t len, unsigned flags
 ) {
-    return json_hmap_del(json, object->data.hmap, key, true);
+    json_ctx_t ctx;
+
+    json_ctx_make(&ctx, json, text, len, flags);
+    json_parse_document(&ctx);
+    json_ctx_done(&ctx);
 }
 
-json_object_t *json_new_object(json_t *json) {
-    json_object_t *object = json_empty_object(json);
+// runs parse on ctx with errors reported to error, returns false if one was.
+// ctx belongs to the caller so none of its state is lost to the longjmp()
+static bool json_try_parse(
+    json_ctx_t *ctx, void (*parse)(json_ctx_t *), json_error_t *error
+) {
+    jmp_buf jmp;
 
-    object->type = JSON_OBJECT;
-    object->data.hmap = (json_hmap_t *)json_page_alloc(
-        json,
-        sizeof(*object->data.hmap)
-    );
+    ctx->error = error;
+    ctx->jmp = &jmp;
 
-    json_hmap_make(json, object->data.hmap, JSON_HMAP_INIT_CAP);
+    if (setjmp(jmp))
+        return false;
 
-    return object;
+    parse(ctx);
+
+    error->code = JSON_ERR_NONE;
+    error->offset = 0;
+    error->message[0] = '\0';
+
+    return true;
 }
 
-json_object_t *json_new_array(
-    json_t *json, json_object_t **objects, size_t size
-) {
-    json_object_t *object = json_empty_object(json);
+// file loading ================================================================
 
-    object->type = JSON_ARRAY;
-    object->data.vec = (json_vec_t *)json_page_alloc(
-        json,
-        sizeof(*object->data.vec)
-    );
+#if !defined(JSON_NO_MMAP) && (defined(__unix__) || defined(__APPLE__))
+#define JSON_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
-    json_vec_make(json, object->data.vec, size);
+#ifdef JSON_MMAP
 
-    for (size_t i = 0; i < size; ++i)
-        json_vec_push(json, object->data.vec, objects[i]);
+// maps or reads a file into memory, writable maps are private copies.
+// returns whether the text is a mapping (released with munmap) rather than a
+// JSON_MALLOC buffer
+static bool json_open_file(
+    const char *filepath, bool writable, char **out_text, size_t *out_len
+) {
+    int fd = open(filepath, O_RDONLY);
+    struct stat st;
 
-    return object;
-}
+    if (fd < 0 || fstat(fd, &st) < 0)
+        JSON_ERROR("could not open file: \"%s\"\n", filepath);
 
-json_object_t *json_new_string(json_t *json, char *string) {
-    json_object_t *object = json_empty_object(json);
+    bool sized = S_ISREG(st.st_mode) && st.st_size > 0;
+    size_t len = (size_t)st.st_size;
 
-    object->type = JSON_STRING;
-    object->data.string = (char *)json_page_alloc(
-        json,
-        (strlen(string) + 1) * sizeof(*string)
-    );
+    if (sized) {
+        int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+        void *map = mmap(NULL, len, prot, MAP_PRIVATE, fd, 0);
 
-    strcpy(object->data.string, string);
+        if (map != MAP_FAILED) {
+            close(fd);
 
-    return object;
-}
+            *out_text = (char *)map;
+            *out_len = len;
 
-json_object_t *json_new_number(json_t *json, double number) {
-    json_object_t *object = json_empty_object(json);
+            return true;
+        }
+    }
 
-    object->type = JSON_NUMBER;
-    object->data.number = number;
+    // read in a single fstat-sized pass, or grow the buffer for files which
+    // don't know their size (pipes, character devices etc.)
+    size_t cap = sized ? len : JSON_FREAD_BUF_SIZE;
+    char *text = (char *)JSON_MALLOC(cap);
+    size_t total = 0;
+    ssize_t num_read;
 
-    return object;
-}
+    while ((num_read = read(fd, text + total, cap - total)) > 0) {
+        total += (size_t)num_read;
 
-json_object_t *json_new_bool(json_t *json, bool value) {
-    json_object_t *object = json_empty_object(json);
+        if (total == cap) {
+            if (sized)
+                break;
 
-    object->type = value ? JSON_TRUE : JSON_FALSE;
+            char *new_text = (char *)JSON_MALLOC(cap <<= 1);
 
-    return object;
-}
+            memcpy(new_text, text, total);
+            JSON_FREE(text);
+            text = new_text;
+        }
+    }
 
-json_object_t *json_new_null(json_t *json) {
-    json_object_t *object = json_empty_object(json);
+    close(fd);
 
-    object->type = JSON_NULL;
+    *out_text = text;
+    *out_len = total;
 
-    return object;
+    return false;
 }
 
-json_object_t *json_copy(json_t *json, json_object_t *object) {
-    json_object_t *copied = json_empty_object(json);
+#else
 
-    copied->type = object->type;
+// read buffers are always writable
+static bool json_open_file(
+    const char *filepath, bool writable, char **out_text, size_t *out_len
+) {
+    (void)writable;
 
-    switch (copied->type) {
-    case JSON_OBJECT:
-        // init hmap
-        copied->data.hmap = (json_hmap_t *)json_page_alloc(
-            json,
-            sizeof(*copied->data.hmap)
-        );
+    FILE *file = fopen(filepath, "rb");
 
-        json_hmap_make(json, copied->data.hmap, JSON_HMAP_INIT_CAP);
+    if (!file)
+        JSON_ERROR("could not open file: \"%s\"\n", filepath);
 
-        // copy data
-        size_t num_keys;
-        char **keys = json_get_keys(object, &num_keys);
+    // measure the file if possible, otherwise grow the buffer as it's read
+    long len = -1;
 
-        for (size_t i = 0; i < num_keys; ++i) {
-            json_object_t *child = json_get_object(object, keys[i]);
+    if (!fseek(file, 0, SEEK_END)) {
+        len = ftell(file);
+        rewind(file);
+    }
 
-            json_put(json, copied, keys[i], json_copy(json, child));
-        }
+    bool sized = len > 0;
+    size_t cap = sized ? (size_t)len : JSON_FREAD_BUF_SIZE;
+    char *text = (char *)JSON_MALLOC(cap);
+    size_t total = 0, num_read;
 
-        break;
-    case JSON_ARRAY:
-        // init vec
-        copied->data.vec = (json_vec_t *)json_page_alloc(
-            json,
-            sizeof(*copied->data.vec)
-        );
+    while ((num_read = fread(text + total, 1, cap - total, file)) > 0) {
+        total += num_read;
 
-        // copy data
-        size_t size;
-        json_object_t **children = json_to_array(object, &size);
+        if (total == cap) {
+            if (sized)
+                break;
 
-        json_vec_make(json, copied->data.vec, size);
+            char *new_text = (char *)JSON_MALLOC(cap <<= 1);
 
-        for (size_t i = 0; i < size; ++i)
-            json_vec_push(json, copied->data.vec, json_copy(json, children[i]));
+            memcpy(new_text, text, total);
+            JSON_FREE(text);
+            text = new_text;
+        }
+    }
 
-        break;
-    case JSON_STRING:;
-        // allocate new string and copy
-        char *string = object->data.string;
+    fclose(file);
 
-        copied->data.string = (char *)json_page_alloc(
-            json,
-            // TODO store string lengths for objects?
-            (strlen(string) + 1) * sizeof(*string)
-        );
+    *out_text = text;
+    *out_len = total;
 
-        strcpy(copied->data.string, string);
+    return false;
+}
 
-        break;
-    default:
-        copied->data = object->data;
+#endif
 
-        break;
+static void json_close_file(char *text, size_t len, bool mapped) {
+#ifdef JSON_MMAP
+    if (mapped) {
+        munmap(text, len);
+        return;
     }
+#else
+    (void)len;
+    (void)mapped;
+#endif
 
-    return copied;
+    JSON_FREE(text);
 }
 
-void json_put(
-    json_t *json, json_object_t *object, char *key, json_object_t *child
-) {
-    JSON_ASSERT(
-        object->type == JSON_OBJECT,
-        "called put_object on a non-object.\n"
-    );
+// lifetime api ================================================================
 
-    json_hmap_put(json, object->data.hmap, key, child);
+void json_load_empty(json_t *json) {
+    json_load_empty_alloc(json, &json_default_allocator);
 }
 
-void json_put_copy(
-    json_t *json, json_object_t *object, char *key, json_object_t *child
-) {
-    json_put(json, object, key, json_copy(child));
-}
+void json_load_empty_alloc(json_t *json, const json_allocator_t *allocator) {
+    json->allocator = *allocator;
+    json->root = NULL;
+    json->file_text = NULL;
+    json->scratch = NULL;
+    json->scratch_cap = 0;
+    json->interns = NULL;
+    json->intern_count = json->intern_cap = 0;
+    json->frozen = false;
+    memset(&json->stats, 0, sizeof(json->stats));
+
+    // page allocator
+    json->cur_page = json->used = 0;
+    json->page_count = 1;
+    json->page_cap = JSON_INIT_PAGE_CAP;
+    json->pages = (char **)json_fat_alloc(
+        &json->allocator,
+        json->page_cap * sizeof(*json->pages)
+    );
+
+    json->pages[0] = (char *)json_fat_alloc(&json->allocator, JSON_PAGE_SIZE);
+    json->page_size = JSON_PAGE_SIZE;
+    json->grow_size = JSON_PAGE_SIZE << 1;
+
+    JSON_STAT_ADD(json, pages, 1);
+    JSON_STAT_ADD(json, page_bytes, JSON_PAGE_SIZE);
+
+    // tracking allocator
+    json->cur_tracked = 0;
+    json->tracked_cap = JSON_INIT_TRACKED_CAP;
+    json->tracked = (json_tptr_t **)json_fat_alloc(
+        &json->allocator,
+        json->tracked_cap * sizeof(*json->tracked)
+    );
+
+    JSON_DEBUG("tracked size %zu.\n", *((size_t *)json->tracked - 1));
+
+    for (size_t i = 0; i < json->tracked_cap; ++i)
+        json->tracked[i] = NULL;
+}
+
+void json_reset(json_t *json) {
+    json->root = NULL;
+    json->frozen = false;
+    memset(&json->stats, 0, sizeof(json->stats));
+
+    // rewind pages
+    json->cur_page = json->used = 0;
+    json->page_size = json_fat_size(json->pages[0]);
+
+    // free tracked
+    for (size_t i = 0; i < json->cur_tracked; ++i) {
+        if (json->tracked[i]) {
+            json_release_tracked(json, i);
+            json->tracked[i] = NULL;
+        }
+    }
+
+    json->cur_tracked = 0;
+
+    // interned strings were on the pages, the table is kept for the next load
+    if (json->intern_count) {
+        memset(json->interns, 0, json->intern_cap * sizeof(*json->interns));
+        json->intern_count = 0;
+    }
+
+    if (json->file_text) {
+        json_close_file(json->file_text, json->file_len, json->file_mapped);
+        json->file_text = NULL;
+    }
+}
+
+void json_reserve(json_t *json, size_t size) {
+    if (json->page_size - json->used >= size)
+        return;
+
+    // kept pages get reused when they're big enough
+    json_next_page(json, size, size);
+}
+
+// reserves pages for parsing len bytes of text. other allocators may hand out
+// real memory, like a bump buffer, so they only grow pages as they're needed
+static inline void json_reserve_text(json_t *json, size_t len) {
+    if (JSON_RESERVE_RATIO
+     && json->allocator.alloc == json_default_allocator.alloc)
+        json_reserve(json, len * JSON_RESERVE_RATIO);
+}
+
+// starts a load of len bytes of text, resetting json for JSON_LOAD_REUSE
+static inline void json_load_begin(json_t *json, size_t len, unsigned flags) {
+    if (flags & JSON_LOAD_REUSE)
+        json_reset(json);
+    else
+        json_load_empty(json);
+
+    // parallel loads reserve for each range on their own, and lazy ones only
+    // use a little of the text's size
+    if (!(flags & (JSON_LOAD_PARALLEL | JSON_LOAD_LAZY)))
+        json_reserve_text(json, len);
+}
+
+static void json_parse(
+    json_t *json, const char *text, size_t len, unsigned flags
+);
+static void json_parse_parallel(
+    json_t *json, const char *text, size_t len, unsigned flags
+);
+
+void json_load(json_t *json, char *text) {
+    json_load_n(json, text, strlen(text));
+}
+
+void json_load_n(json_t *json, const char *text, size_t len) {
+    json_load_begin(json, len, 0);
+    json_parse(json, text, len, 0);
+}
+
+void json_load_ex(json_t *json, char *text, size_t len, unsigned flags) {
+    json_load_begin(json, len, flags);
+
+    // lazy spans point at the json_t they were loaded on, so they can't be
+    // moved between the contexts of a parallel load
+    if ((flags & JSON_LOAD_PARALLEL) && !(flags & JSON_LOAD_LAZY))
+        json_parse_parallel(json, text, len, flags);
+    else
+        json_parse(json, text, len, flags);
+}
+
+bool json_try_load(
+    json_t *json, char *text, size_t len, unsigned flags, json_error_t *error
+) {
+    json_error_t discarded;
+    json_ctx_t ctx;
+
+    flags &= ~(unsigned)(JSON_LOAD_PARALLEL | JSON_LOAD_LAZY);
+
+    json_load_begin(json, len, flags);
+    json_ctx_make(&ctx, json, text, len, flags);
+
+    bool parsed = json_try_parse(
+        &ctx,
+        json_parse_document,
+        error ? error : &discarded
+    );
+
+    json_ctx_done(&ctx);
+
+    // whatever was parsed before the error is dropped with the pages
+    if (!parsed)
+        json_reset(json);
+
+    return parsed;
+}
+
+void json_error_position(
+    const char *text, size_t offset, size_t *out_line, size_t *out_column
+) {
+    size_t line = 1, line_start = 0;
+
+    for (size_t i = 0; i < offset; ++i) {
+        if (text[i] == '\n') {
+            ++line;
+            line_start = i + 1;
+        }
+    }
+
+    *out_line = line;
+    *out_column = offset - line_start + 1;
+}
+
+void json_load_file(json_t *json, const char *filepath) {
+    char *text;
+    size_t len;
+    bool mapped = json_open_file(filepath, false, &text, &len);
+
+    json_load_n(json, text, len);
+    json_close_file(text, len, mapped);
+}
+
+void json_load_mapped(json_t *json, const char *filepath, unsigned flags) {
+    char *text;
+    size_t len;
+    bool mapped = json_open_file(
+        filepath,
+        flags & JSON_LOAD_INSITU,
+        &text,
+        &len
+    );
+
+    json_load_ex(json, text, len, flags);
+
+    json->file_text = text;
+    json->file_len = len;
+    json->file_mapped = mapped;
+}
+
+// recursively free object hashmap and array vectors
+void json_unload(json_t *json) {
+    // free pages
+    for (size_t i = 0; i < json->page_count; ++i)
+        json_fat_free(&json->allocator, json->pages[i]);
+
+    json_fat_free(&json->allocator, json->pages);
+
+    if (json->scratch)
+        json_release(&json->allocator, json->scratch, json->scratch_cap);
+
+    // free tracked
+    for (size_t i = 0; i <= json->cur_tracked; ++i)
+        if (json->tracked[i])
+            json_release_tracked(json, i);
+
+    json_fat_free(&json->allocator, json->tracked);
+    json_interns_free(json);
+
+    if (json->file_text)
+        json_close_file(json->file_text, json->file_len, json->file_mapped);
+}
+
+// threads =====================================================================
+
+// JSON_THREADS runs parallel loads on pthreads, which needs -pthread
+#ifdef JSON_THREADS
+#include <pthread.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+#endif
+
+// workers get at least this many bytes of text, so small texts aren't split
+// up only to pay for threads
+#define JSON_MIN_WORKER_TEXT 262144
+
+// a unit of work for json_run_jobs(), embedded at the start of a worker struct
+typedef struct json_job {
+    void (*run)(struct json_job *);
+
+#ifdef JSON_THREADS
+    pthread_t thread;
+    bool started;
+#endif
+} json_job_t;
+
+// number of workers for len bytes of text on up to threads, 0 is one per cpu
+static size_t json_worker_count(size_t len, unsigned threads) {
+#ifdef JSON_THREADS
+    size_t count = threads;
+
+    if (!count) {
+#ifdef _SC_NPROCESSORS_ONLN
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+        count = cpus > 0 ? (size_t)cpus : 1;
+#else
+        count = 1;
+#endif
+    }
+
+    if (count > len / JSON_MIN_WORKER_TEXT)
+        count = len / JSON_MIN_WORKER_TEXT;
+
+    return count ? count : 1;
+#else
+    (void)len;
+    (void)threads;
+
+    return 1;
+#endif
+}
+
+#ifdef JSON_THREADS
+static void *json_job_thread(void *job) {
+    ((json_job_t *)job)->run((json_job_t *)job);
+
+    return NULL;
+}
+#endif
+
+// runs count jobs laid out stride bytes apart and waits for all of them. the
+// calling thread takes the first job, and any a thread can't be started for
+static void json_run_jobs(void *jobs, size_t stride, size_t count) {
+#define JSON_JOB(i) ((json_job_t *)((char *)jobs + (i) * stride))
+#ifdef JSON_THREADS
+    for (size_t i = 1; i < count; ++i) {
+        JSON_JOB(i)->started = !pthread_create(
+            &JSON_JOB(i)->thread,
+            NULL,
+            json_job_thread,
+            JSON_JOB(i)
+        );
+    }
+
+    JSON_JOB(0)->run(JSON_JOB(0));
+
+    for (size_t i = 1; i < count; ++i) {
+        if (JSON_JOB(i)->started)
+            pthread_join(JSON_JOB(i)->thread, NULL);
+        else
+            JSON_JOB(i)->run(JSON_JOB(i));
+    }
+#else
+    for (size_t i = 0; i < count; ++i)
+        JSON_JOB(i)->run(JSON_JOB(i));
+#endif
+#undef JSON_JOB
+}
+
+// json lines ==================================================================
+
+typedef struct json_lines_worker {
+    json_job_t job;
+    json_t *json;
+    char *text;
+    size_t start, end; // whole lines of text
+    unsigned flags;
+
+    // json_object_t * roots of this worker's lines
+    char *roots;
+    size_t roots_size, roots_cap;
+} json_lines_worker_t;
+
+// parses each line of the worker's range as its own document. the ctx covers
+// the whole text so errors report the line number within it
+static void json_lines_run(json_job_t *job) {
+    json_lines_worker_t *worker = (json_lines_worker_t *)job;
+    json_t *json = worker->json;
+    json_ctx_t ctx;
+    size_t line = worker->start;
+
+    json_load_begin(json, worker->end - worker->start, worker->flags);
+    json_ctx_make(&ctx, json, worker->text, worker->end, worker->flags);
+
+    while (line < worker->end) {
+        const char *newline = (const char *)memchr(
+            worker->text + line,
+            '\n',
+            worker->end - line
+        );
+        size_t line_end = newline
+            ? (size_t)(newline - worker->text)
+            : worker->end;
+
+        ctx.index = line;
+        ctx.len = line_end;
+        json_next_token(&ctx);
+
+        // blank lines are skipped
+        if (ctx.index < ctx.len) {
+            json_object_t *root = json_parse_root(&ctx);
+
+            json_next_token(&ctx);
+
+            if (!root || ctx.index != ctx.len)
+                JSON_CTX_ERROR(&ctx, "unexpected text after json line.\n");
+
+            json_buf_reserve(
+                &json_default_allocator,
+                &worker->roots,
+                &worker->roots_cap,
+                worker->roots_size + sizeof(root)
+            );
+            memcpy(worker->roots + worker->roots_size, &root, sizeof(root));
+            worker->roots_size += sizeof(root);
+        }
+
+        line = line_end + 1;
+    }
+
+    json_ctx_done(&ctx);
+}
+
+void json_lines_load(
+    json_lines_t *lines, char *text, size_t len, unsigned flags,
+    unsigned threads
+) {
+    const json_allocator_t *allocator = &json_default_allocator;
+
+    if (!(flags & JSON_LOAD_REUSE)) {
+        lines->roots = NULL;
+        lines->roots_cap = 0;
+        lines->contexts = NULL;
+        lines->context_count = 0;
+        lines->file_text = NULL;
+    } else if (lines->file_text) {
+        json_close_file(lines->file_text, lines->file_len, lines->file_mapped);
+        lines->file_text = NULL;
+    }
+
+    // one context per worker, kept ones are reused
+    size_t count = json_worker_count(len, threads);
+    size_t kept = lines->context_count;
+
+    if (count > kept) {
+        lines->contexts = (json_t *)(lines->contexts
+            ? json_resize(
+                allocator,
+                lines->contexts,
+                kept * sizeof(*lines->contexts),
+                count * sizeof(*lines->contexts)
+            )
+            : json_alloc(allocator, count * sizeof(*lines->contexts)));
+        lines->context_count = count;
+    }
+
+    for (size_t i = count; i < kept; ++i)
+        json_reset(&lines->contexts[i]);
+
+    // split the text into equal ranges, each ending on a newline
+    json_lines_worker_t *workers = (json_lines_worker_t *)json_alloc(
+        allocator,
+        count * sizeof(*workers)
+    );
+    size_t start = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        json_lines_worker_t *worker = &workers[i];
+        size_t end = i + 1 == count ? len : len / count * (i + 1);
+
+        if (end < start) {
+            end = start;
+        } else if (end < len) {
+            const char *newline = (const char *)memchr(
+                text + end,
+                '\n',
+                len - end
+            );
+
+            end = newline ? (size_t)(newline - text) + 1 : len;
+        }
+
+        worker->job.run = json_lines_run;
+        worker->json = &lines->contexts[i];
+        worker->text = text;
+        worker->start = start;
+        worker->end = end;
+        worker->flags = (flags & (JSON_LOAD_INSITU | JSON_LOAD_LAZY
+                                  | JSON_LOAD_INTERN))
+                      | (i < kept ? JSON_LOAD_REUSE : 0);
+        worker->roots = NULL;
+        worker->roots_size = worker->roots_cap = 0;
+
+        start = end;
+    }
+
+    // the first worker collects into the roots kept from the last load
+    workers[0].roots = (char *)lines->roots;
+    workers[0].roots_cap = lines->roots_cap;
+
+    json_run_jobs(workers, sizeof(*workers), count);
+
+    // append the other workers' roots in order
+    size_t total = 0;
+
+    for (size_t i = 0; i < count; ++i)
+        total += workers[i].roots_size;
+
+    json_buf_reserve(
+        allocator,
+        &workers[0].roots,
+        &workers[0].roots_cap,
+        total
+    );
+
+    for (size_t i = 1; i < count; ++i) {
+        json_lines_worker_t *worker = &workers[i];
+
+        if (!worker->roots)
+            continue;
+
+        memcpy(
+            workers[0].roots + workers[0].roots_size,
+            worker->roots,
+            worker->roots_size
+        );
+        workers[0].roots_size += worker->roots_size;
+
+        json_release(allocator, worker->roots, worker->roots_cap);
+    }
+
+    lines->roots = (json_object_t **)workers[0].roots;
+    lines->roots_cap = workers[0].roots_cap;
+    lines->count = total / sizeof(*lines->roots);
+
+    json_release(allocator, workers, count * sizeof(*workers));
+}
+
+void json_lines_load_file(
+    json_lines_t *lines, const char *filepath, unsigned flags,
+    unsigned threads
+) {
+    char *text;
+    size_t len;
+    bool mapped = json_open_file(
+        filepath,
+        flags & JSON_LOAD_INSITU,
+        &text,
+        &len
+    );
+
+    json_lines_load(lines, text, len, flags, threads);
+
+    // insitu strings and lazy containers point into the text
+    if (flags & (JSON_LOAD_INSITU | JSON_LOAD_LAZY)) {
+        lines->file_text = text;
+        lines->file_len = len;
+        lines->file_mapped = mapped;
+    } else {
+        json_close_file(text, len, mapped);
+    }
+}
+
+void json_lines_unload(json_lines_t *lines) {
+    const json_allocator_t *allocator = &json_default_allocator;
+
+    for (size_t i = 0; i < lines->context_count; ++i)
+        json_unload(&lines->contexts[i]);
+
+    if (lines->contexts) {
+        json_release(
+            allocator,
+            lines->contexts,
+            lines->context_count * sizeof(*lines->contexts)
+        );
+    }
+
+    if (lines->roots)
+        json_release(allocator, lines->roots, lines->roots_cap);
+
+    if (lines->file_text)
+        json_close_file(lines->file_text, lines->file_len, lines->file_mapped);
+}
+
+// parallel parsing ============================================================
+
+// JSON_LOAD_PARALLEL splits the root's elements or members into ranges of
+// about equal length. a quick scan over the structural characters finds the
+// root's commas, then each range is parsed onto the scratch stack of its own
+// json_t and the results are gathered into the root
+
+// a range of the root parsed by one worker, the first one loads straight into
+// the json_t being loaded
+typedef struct json_part {
+    json_job_t job;
+    json_t *json;
+    json_t own;
+    const json_allocator_t *allocator;
+    json_ctx_t ctx;
+
+    const char *text;
+    size_t start, end;
+    unsigned flags;
+    char close; // the root's closing bracket for the last range, otherwise '\0'
+    bool object;
+} json_part_t;
+
+// finds up to count - 1 commas separating the root's children, the first past
+// each count-th of the text, starting just past the root's opening bracket.
+// depth only needs counting bit by bit in blocks which might hold a split or
+// the end of the root. anything odd is left for the parser to report. returns
+// the number of commas found
+static size_t json_split_root(
+    const char *text, size_t index, size_t len, size_t *splits, size_t count
+) {
+    json_block_carry_t carry = {0, 0};
+    size_t depth = 1, found = 0;
+    size_t target = len / count;
+
+    for (; index < len; index += 64) {
+        json_block_t block;
+
+        json_read_block(text, index, len, &block, &carry);
+
+        // depth can't drop to the root's and no split is due
+        size_t closes = json_popcount64(block.close);
+
+        if (closes < depth && (depth - closes > 1 || index + 64 <= target)) {
+            depth = depth + json_popcount64(block.open) - closes;
+            continue;
+        }
+
+        uint64_t bits = block.open | block.close | block.comma;
+
+        for (; bits; bits &= bits - 1) {
+            uint64_t bit = bits & -bits;
+
+            if (bit & block.open) {
+                ++depth;
+            } else if (bit & block.close) {
+                if (!--depth)
+                    return found;
+            } else if (depth == 1 && index + json_ctz64(bit) >= target) {
+                splits[found++] = index + json_ctz64(bit);
+
+                if (found + 1 == count)
+                    return found;
+
+                target = len / count * (found + 1);
+            }
+        }
+    }
+
+    return found;
+}
+
+static void json_part_run(json_job_t *job) {
+    json_part_t *part = (json_part_t *)job;
+    json_ctx_t *ctx = &part->ctx;
+
+    if (part->json == &part->own)
+        json_load_empty_alloc(&part->own, part->allocator);
+
+    json_reserve_text(part->json, part->end - part->start);
+
+    json_ctx_make(ctx, part->json, part->text, part->end, part->flags);
+    ctx->index = part->start;
+    json_next_token(ctx);
+
+    json_expect_children(ctx, part->close, part->object);
+
+    // a range ending on a split stops at the end of its text
+    if (!part->close) {
+        if (ctx->index != ctx->len)
+            JSON_CTX_ERROR(ctx, "unknown token, expected \",\".\n");
+
+        return;
+    }
+
+    ++ctx->index; // skip ']' or '}'
+
+    // only whitespace may follow the root
+    json_next_token(ctx);
+
+    if (ctx->index != ctx->len)
+        JSON_CTX_ERROR(ctx, "unexpected text after json root.\n");
+}
+
+static void json_parse_parallel(
+    json_t *json, const char *text, size_t len, unsigned flags
+) {
+    const json_allocator_t *allocator = &json->allocator;
+    size_t workers = json_worker_count(len, 0);
+    size_t start = json_skip_whitespace(text, 0, len);
+    char open = start < len ? text[start] : '\0';
+
+    // other allocators aren't necessarily thread safe
+    if (json->allocator.alloc != json_default_alloc
+     || (open != '[' && open != '{')) {
+        workers = 1;
+    }
+
+    size_t count = 1;
+    size_t *splits = NULL;
+
+    if (workers > 1) {
+        splits = (size_t *)json_alloc(allocator, workers * sizeof(*splits));
+        count += json_split_root(text, start + 1, len, splits, workers);
+    }
+
+    if (count == 1) {
+        if (splits)
+            json_release(allocator, splits, workers * sizeof(*splits));
+
+        json_reserve_text(json, len);
+
+        json_parse(json, text, len, flags);
+
+        return;
+    }
+
+    json_part_t *parts = (json_part_t *)json_alloc(
+        allocator,
+        count * sizeof(*parts)
+    );
+
+    for (size_t i = 0; i < count; ++i) {
+        json_part_t *part = &parts[i];
+
+        part->job.run = json_part_run;
+        part->json = i ? &part->own : json;
+        part->allocator = allocator;
+        part->text = text;
+        part->start = i ? splits[i - 1] + 1 : start + 1;
+        part->end = i + 1 < count ? splits[i] : len;
+        part->flags = flags;
+        part->close = i + 1 < count ? '\0' : open == '[' ? ']' : '}';
+        part->object = open == '{';
+    }
+
+    json_run_jobs(parts, sizeof(*parts), count);
+
+    // gather every range's children in order on the first one's scratch stack,
+    // and take over the memory they point to
+    json_ctx_t *ctx = &parts[0].ctx;
+
+    for (size_t i = 1; i < count; ++i) {
+        json_part_t *part = &parts[i];
+
+        if (part->ctx.scratch_size) {
+            memcpy(
+                json_scratch_push(ctx, part->ctx.scratch_size),
+                part->ctx.scratch,
+                part->ctx.scratch_size
+            );
+        }
+
+        json_ctx_done(&part->ctx);
+        json_absorb(json, &part->own);
+    }
+
+    json_object_t *root = (json_object_t *)json_page_alloc(json, sizeof(*root));
+
+    if (open == '{') {
+        root->data.hmap = json_hmap_build(
+            json,
+            (json_scratch_entry_t *)ctx->scratch,
+            ctx->scratch_size / sizeof(json_scratch_entry_t)
+        );
+        root->type = JSON_OBJECT;
+    } else {
+        root->data.vec = json_vec_build(
+            json,
+            (json_object_t *)ctx->scratch,
+            ctx->scratch_size / sizeof(json_object_t)
+        );
+        root->type = JSON_ARRAY;
+    }
+
+    root->is_int = false;
+    root->is_lazy = false;
+    json->root = root;
+
+    ctx->scratch_size = 0;
+    json_ctx_done(ctx);
+
+    json_release(allocator, parts, count * sizeof(*parts));
+    json_release(allocator, splits, workers * sizeof(*splits));
+}
+
+// streaming ===================================================================
+
+// the push parser is a state machine over structural characters. scalars are
+// handed to the regular tokenizer once they're complete, tokens cut off by the
+// end of a chunk are collected in parser->token until they are
+typedef enum json_parser_state {
+    JSON_PARSER_ROOT,
+    JSON_PARSER_VALUE,
+    JSON_PARSER_VALUE_OR_END, // after '['
+    JSON_PARSER_KEY,
+    JSON_PARSER_KEY_OR_END, // after '{'
+    JSON_PARSER_COLON,
+    JSON_PARSER_NEXT, // after a value
+    JSON_PARSER_DONE
+} json_parser_state_e;
+
+// token kinds
+#define JSON_TOKEN_NONE '\0'
+#define JSON_TOKEN_KEY 'k'
+#define JSON_TOKEN_STRING 's'
+#define JSON_TOKEN_BARE 'b' // number or literal
+
+// calls a callback if it's set, args is its parenthesized argument list
+#define JSON_SAX_EMIT(fn, args) (!parser->sax.fn || parser->sax.fn args)
+
+static inline bool json_is_delimiter(char ch) {
+    switch (ch) {
+    case ',':
+    case ':':
+    case '[':
+    case ']':
+    case '{':
+    case '}':
+    case '\"':
+        return true;
+    default:
+        return json_is_whitespace(ch);
+    }
+}
+
+// finds the end of a string token from inside the string. returns whether it
+// ends in this chunk, escape carries a trailing backslash over to the next one
+static bool json_scan_string_token(
+    const char *text, size_t index, size_t len, bool *escape, size_t *out_end
+) {
+    if (*escape && index < len) {
+        *escape = false;
+        ++index;
+    }
+
+    while ((index = json_scan_string(text, index, len)) < len) {
+        char ch = text[index];
+
+        // closing quote, or a bad character for the tokenizer to report
+        if (ch == '\"' || ch == '\n' || ch == '\0') {
+            *out_end = index + 1;
+            return true;
+        }
+
+        // other control characters are part of the string
+        if (ch != '\\') {
+            ++index;
+            continue;
+        }
+
+        if (index + 1 == len) {
+            *escape = true;
+            break;
+        }
+
+        index += 2;
+    }
+
+    *out_end = len;
+
+    return false;
+}
+
+// finds the end of a number or literal token, which needs a delimiter
+static bool json_scan_bare_token(
+    const char *text, size_t index, size_t len, size_t *out_end
+) {
+    while (index < len && !json_is_delimiter(text[index]))
+        ++index;
+
+    *out_end = index;
+
+    return index < len;
+}
+
+// sets up ctx over text, sharing the parser's stack
+static void json_parser_ctx(
+    json_parser_t *parser, json_ctx_t *ctx, const char *text, size_t len
+) {
+    ctx->json = parser->json;
+    ctx->text = text;
+    ctx->insitu = NULL;
+    ctx->index = 0;
+    ctx->len = len;
+    ctx->allocator = &parser->allocator;
+    ctx->scratch = parser->stack;
+    ctx->scratch_size = parser->depth;
+    ctx->scratch_cap = parser->stack_cap;
+    ctx->transient = parser->json == NULL;
+    ctx->lazy = false;
+    ctx->nodes = NULL;
+    ctx->node = ctx->node_end = 0;
+    ctx->intern = parser->intern;
+    ctx->error = NULL;
+    ctx->jmp = NULL;
+}
+
+static inline void json_parser_sync(json_parser_t *parser, json_ctx_t *ctx) {
+    parser->stack = ctx->scratch;
+    parser->depth = ctx->scratch_size;
+    parser->stack_cap = ctx->scratch_cap;
+}
+
+static inline void json_parser_after_value(
+    json_parser_t *parser, json_ctx_t *ctx
+) {
+    parser->state = ctx->scratch_size ? JSON_PARSER_NEXT : JSON_PARSER_DONE;
+}
+
+// parses a complete token of kind at ctx->index
+static inline void json_parser_token(json_parser_t *parser, json_ctx_t *ctx, char kind) {
+    bool ok;
+
+    if (kind != JSON_TOKEN_BARE) {
+        size_t length;
+        json_hash_t hash;
+        // keys are only interned when they're hashed
+        char *str = json_expect_string(
+            ctx,
+            &length,
+            kind == JSON_TOKEN_KEY && ctx->intern ? &hash : NULL
+        );
+
+        if (kind == JSON_TOKEN_KEY) {
+            ok = JSON_SAX_EMIT(key, (parser->sax.user, str, length));
+            parser->state = JSON_PARSER_COLON;
+        } else {
+            ok = JSON_SAX_EMIT(string, (parser->sax.user, str, length));
+            json_parser_after_value(parser, ctx);
+        }
+
+        parser->stopped = !ok;
+
+        return;
+    }
+
+    switch (json_peek(ctx)) {
+    case 't':
+        json_expect_token(ctx, "true", 4);
+        ok = JSON_SAX_EMIT(boolean, (parser->sax.user, true));
+
+        break;
+    case 'f':
+        json_expect_token(ctx, "false", 5);
+        ok = JSON_SAX_EMIT(boolean, (parser->sax.user, false));
+
+        break;
+    case 'n':
+        json_expect_token(ctx, "null", 4);
+        ok = JSON_SAX_EMIT(null, (parser->sax.user));
+
+        break;
+    default: {
+        json_object_t number;
+
+        json_expect_number(ctx, &number);
+
+        if (number.is_int && parser->sax.integer) {
+            ok = parser->sax.integer(parser->sax.user, number.data.integer);
+        } else {
+            ok = JSON_SAX_EMIT(number, (
+                parser->sax.user,
+                number.is_int ? (double)number.data.integer : number.data.number
+            ));
+        }
+
+        break;
+    }
+    }
+
+    if (ctx->index < ctx->len && !json_is_delimiter(ctx->text[ctx->index]))
+        JSON_CTX_ERROR(ctx, "unknown token, expected value.\n");
+
+    json_parser_after_value(parser, ctx);
+    parser->stopped = !ok;
+}
+
+static void json_parser_save_token(
+    json_parser_t *parser, const char *text, size_t len
+) {
+    json_buf_reserve(
+        &parser->allocator,
+        &parser->token,
+        &parser->token_cap,
+        parser->token_len + len
+    );
+
+    memcpy(parser->token + parser->token_len, text, len);
+    parser->token_len += len;
+}
+
+// parses the token collected in parser->token
+static void json_parser_flush_token(json_parser_t *parser) {
+    json_ctx_t ctx;
+
+    json_parser_ctx(parser, &ctx, parser->token, parser->token_len);
+    json_parser_token(parser, &ctx, parser->token_kind);
+    json_parser_sync(parser, &ctx);
+
+    parser->token_kind = JSON_TOKEN_NONE;
+    parser->token_len = 0;
+}
+
+// continues a cut off token, returns how much of buf it took
+static size_t json_parser_resume_token(
+    json_parser_t *parser, const char *buf, size_t len
+) {
+    size_t end;
+    bool complete = parser->token_kind == JSON_TOKEN_BARE
+        ? json_scan_bare_token(buf, 0, len, &end)
+        : json_scan_string_token(buf, 0, len, &parser->token_escape, &end);
+
+    json_parser_save_token(parser, buf, end);
+
+    if (complete)
+        json_parser_flush_token(parser);
+
+    return end;
+}
+
+// parses the token starting at ctx->index, or saves it if it's cut off
+static inline void json_parser_start_token(
+    json_parser_t *parser, json_ctx_t *ctx, char kind
+) {
+    size_t start = ctx->index, end;
+    bool complete;
+
+    // nothing can be cut off in the last of the text
+    if (parser->last) {
+        json_parser_token(parser, ctx, kind);
+        return;
+    }
+
+    if (kind == JSON_TOKEN_BARE) {
+        complete = json_scan_bare_token(ctx->text, start, ctx->len, &end);
+    } else {
+        parser->token_escape = false;
+        complete = json_scan_string_token(
+            ctx->text,
+            start + 1,
+            ctx->len,
+            &parser->token_escape,
+            &end
+        );
+    }
+
+    if (complete) {
+        json_parser_token(parser, ctx, kind);
+        return;
+    }
+
+    parser->token_kind = kind;
+    json_parser_save_token(parser, ctx->text + start, ctx->len - start);
+
+    ctx->index = ctx->len;
+}
+
+// handles the token or structural character at ctx->index
+static inline void json_parser_step(json_parser_t *parser, json_ctx_t *ctx) {
+    char ch = json_peek(ctx);
+    char open = ctx->scratch_size ? ctx->scratch[ctx->scratch_size - 1] : '\0';
+
+    switch (parser->state) {
+    case JSON_PARSER_DONE:
+        JSON_CTX_ERROR(ctx, "unexpected text after json root.\n");
+    case JSON_PARSER_ROOT:
+        if (ch != '{' && ch != '[')
+            JSON_CTX_ERROR(ctx, "invalid json root.\n");
+
+        break;
+    case JSON_PARSER_NEXT:
+        if (ch != (open == '{' ? '}' : ']')) {
+            if (ch != ',')
+                json_expect_token(ctx, ",", 1);
+
+            ++ctx->index;
+            parser->state = open == '{' ? JSON_PARSER_KEY : JSON_PARSER_VALUE;
+
+            return;
+        }
+
+        // fallthrough
+    case JSON_PARSER_VALUE_OR_END:
+    case JSON_PARSER_KEY_OR_END:
+        if (ch == (open == '{' ? '}' : ']')) {
+            ++ctx->index;
+            --ctx->scratch_size;
+
+            parser->stopped = open == '{'
+                ? !JSON_SAX_EMIT(end_object, (parser->sax.user))
+                : !JSON_SAX_EMIT(end_array, (parser->sax.user));
+
+            json_parser_after_value(parser, ctx);
+
+            return;
+        }
+
+        break;
+    case JSON_PARSER_COLON:
+        if (ch != ':')
+            json_expect_token(ctx, ":", 1);
+
+        ++ctx->index;
+        parser->state = JSON_PARSER_VALUE;
+
+        return;
+    default:
+        break;
+    }
+
+    if (parser->state == JSON_PARSER_KEY
+     || parser->state == JSON_PARSER_KEY_OR_END) {
+        if (ch != '\"')
+            JSON_CTX_ERROR(ctx, "unknown token, expected string.\n");
+
+        json_parser_start_token(parser, ctx, JSON_TOKEN_KEY);
+
+        return;
+    }
+
+    switch (ch) {
+    case '{':
+    case '[':
+        if (ctx->scratch_size == JSON_MAX_DEPTH) {
+            JSON_CTX_ERROR_CODE(
+                ctx,
+                JSON_ERR_DEPTH,
+                "json nested deeper than JSON_MAX_DEPTH.\n"
+            );
+        }
+
+        parser->stopped = ch == '{'
+            ? !JSON_SAX_EMIT(start_object, (parser->sax.user))
+            : !JSON_SAX_EMIT(start_array, (parser->sax.user));
+
+        *(char *)json_scratch_push(ctx, 1) = ch;
+        ++ctx->index;
+
+        parser->state = ch == '{'
+            ? JSON_PARSER_KEY_OR_END : JSON_PARSER_VALUE_OR_END;
+
+        break;
+    case '\"':
+        json_parser_start_token(parser, ctx, JSON_TOKEN_STRING);
+
+        break;
+    case 't':
+    case 'f':
+    case 'n':
+    case '-':
+        json_parser_start_token(parser, ctx, JSON_TOKEN_BARE);
+
+        break;
+    default:
+        if (!json_is_digit(ch))
+            JSON_CTX_ERROR(ctx, "unknown token, expected value.\n");
+
+        json_parser_start_token(parser, ctx, JSON_TOKEN_BARE);
+
+        break;
+    }
+}
+
+void json_parser_make(json_parser_t *parser, const json_sax_t *sax) {
+    parser->sax = *sax;
+    parser->allocator = sax->allocator ? *sax->allocator : json_default_allocator;
+    parser->state = JSON_PARSER_ROOT;
+    parser->stopped = false;
+    parser->last = false;
+
+    parser->stack = NULL;
+    parser->depth = parser->stack_cap = 0;
+
+    parser->token = NULL;
+    parser->token_len = parser->token_cap = 0;
+    parser->token_kind = JSON_TOKEN_NONE;
+    parser->token_escape = false;
+
+    parser->json = NULL;
+    parser->build = NULL;
+    parser->build_size = parser->build_cap = 0;
+    parser->intern = false;
+}
+
+bool json_parser_feed(json_parser_t *parser, const char *buf, size_t len) {
+    if (parser->stopped)
+        return false;
+
+    size_t index = 0;
+
+    if (parser->token_kind != JSON_TOKEN_NONE)
+        index = json_parser_resume_token(parser, buf, len);
+
+    json_ctx_t ctx;
+
+    json_parser_ctx(parser, &ctx, buf, len);
+    ctx.index = index;
+
+    while (!parser->stopped) {
+        json_next_token(&ctx);
+
+        if (ctx.index == len)
+            break;
+
+        json_parser_step(parser, &ctx);
+    }
+
+    json_parser_sync(parser, &ctx);
+
+    return !parser->stopped;
+}
+
+bool json_parser_finish(json_parser_t *parser) {
+    if (!parser->stopped) {
+        // a document can end on a bare token, strings need their quote
+        if (parser->token_kind == JSON_TOKEN_BARE)
+            json_parser_flush_token(parser);
+        else if (parser->token_kind != JSON_TOKEN_NONE)
+            JSON_ERROR("string ended unexpectedly.\n");
+
+        if (!parser->stopped && parser->state != JSON_PARSER_DONE
+         && parser->state != JSON_PARSER_ROOT) {
+            JSON_ERROR("json ended unexpectedly.\n");
+        }
+    }
+
+    if (parser->stack)
+        json_release(&parser->allocator, parser->stack, parser->stack_cap);
+    if (parser->token)
+        json_release(&parser->allocator, parser->token, parser->token_cap);
+
+    // give the build stack back to the json_t for its next load
+    if (parser->json) {
+        parser->json->scratch = parser->build;
+        parser->json->scratch_cap = parser->build_cap;
+    }
+
+    return !parser->stopped;
+}
+
+// document builder ============================================================
+
+// json_parser_make_dom() builds a document from the parser's own events. like
+// json_expect_obj/array, children pile up on a stack (the json_t's scratch
+// stack) until their container ends. strings are already on json_t pages
+typedef struct json_build_frame {
+    size_t parent; // offset of the parent frame
+    bool object;
+
+    // key the container will be put under in its parent
+    char *key;
+    size_t key_len;
+} json_build_frame_t;
+
+#define JSON_NO_FRAME ((size_t)-1)
+
+static void *json_build_push(json_parser_t *parser, size_t size) {
+    json_buf_reserve(
+        &parser->allocator,
+        &parser->build,
+        &parser->build_cap,
+        parser->build_size + size
+    );
+
+    void *ptr = parser->build + parser->build_size;
+
+    parser->build_size += size;
+
+    return ptr;
+}
+
+static bool json_build_value(json_parser_t *parser, json_object_t value) {
+    if (parser->build_frame == JSON_NO_FRAME) {
+        json_t *json = parser->json;
+
+        json->root = (json_object_t *)json_page_alloc(json, sizeof(*json->root));
+        *json->root = value;
+    } else if (((json_build_frame_t *)(parser->build + parser->build_frame))
+               ->object) {
+        json_scratch_entry_t *entry = (json_scratch_entry_t *)json_build_push(
+            parser,
+            sizeof(*entry)
+        );
+
+        entry->key = parser->key;
+        entry->len = parser->key_len;
+        entry->hash = json_hash_mem(parser->key, parser->key_len);
+        entry->value = value;
+    } else {
+        *(json_object_t *)json_build_push(parser, sizeof(value)) = value;
+    }
+
+    return true;
+}
+
+static bool json_build_start(json_parser_t *parser, bool object) {
+    size_t offset = parser->build_size;
+    json_build_frame_t *frame = (json_build_frame_t *)json_build_push(
+        parser,
+        JSON_ALIGN(sizeof(*frame))
+    );
+
+    frame->parent = parser->build_frame;
+    frame->object = object;
+    frame->key = parser->key;
+    frame->key_len = parser->key_len;
+
+    parser->build_frame = offset;
+
+    return true;
+}
+
+static bool json_build_end(json_parser_t *parser) {
+    size_t offset = parser->build_frame;
+    json_build_frame_t frame = *(json_build_frame_t *)(parser->build + offset);
+    size_t children = offset + JSON_ALIGN(sizeof(frame));
+    size_t size = parser->build_size - children;
+    json_object_t value;
+
+    value.is_int = false;
+    value.is_lazy = false;
+
+    if (frame.object) {
+        value.type = JSON_OBJECT;
+        value.data.hmap = json_hmap_build(
+            parser->json,
+            (json_scratch_entry_t *)(parser->build + children),
+            size / sizeof(json_scratch_entry_t)
+        );
+    } else {
+        value.type = JSON_ARRAY;
+        value.data.vec = json_vec_build(
+            parser->json,
+            (json_object_t *)(parser->build + children),
+            size / sizeof(json_object_t)
+        );
+    }
+
+    parser->build_size = offset;
+    parser->build_frame = frame.parent;
+    parser->key = frame.key;
+    parser->key_len = frame.key_len;
+
+    return json_build_value(parser, value);
+}
+
+static bool json_build_start_object(void *user) {
+    return json_build_start((json_parser_t *)user, true);
+}
+
+static bool json_build_start_array(void *user) {
+    return json_build_start((json_parser_t *)user, false);
+}
+
+static bool json_build_end_container(void *user) {
+    return json_build_end((json_parser_t *)user);
+}
+
+static bool json_build_key(void *user, const char *key, size_t len) {
+    json_parser_t *parser = (json_parser_t *)user;
+
+    parser->key = (char *)key;
+    parser->key_len = len;
+
+    return true;
+}
+
+static bool json_build_string(void *user, const char *string, size_t len) {
+    json_object_t value;
+
+    (void)len;
+
+    value.type = JSON_STRING;
+    value.is_int = false;
+    value.is_lazy = false;
+    value.data.string = (char *)string;
+
+    return json_build_value((json_parser_t *)user, value);
+}
+
+static bool json_build_number(void *user, double number) {
+    json_object_t value;
+
+    value.type = JSON_NUMBER;
+    value.is_int = false;
+    value.is_lazy = false;
+    value.data.number = number;
+
+    return json_build_value((json_parser_t *)user, value);
+}
+
+static bool json_build_integer(void *user, int64_t integer) {
+    json_object_t value;
+
+    value.type = JSON_NUMBER;
+    value.is_int = true;
+    value.is_lazy = false;
+    value.data.integer = integer;
+
+    return json_build_value((json_parser_t *)user, value);
+}
+
+static bool json_build_boolean(void *user, bool boolean) {
+    json_object_t value;
+
+    value.type = boolean ? JSON_TRUE : JSON_FALSE;
+    value.is_int = false;
+    value.is_lazy = false;
+
+    return json_build_value((json_parser_t *)user, value);
+}
+
+static bool json_build_null(void *user) {
+    json_object_t value;
+
+    value.type = JSON_NULL;
+    value.is_int = false;
+    value.is_lazy = false;
+
+    return json_build_value((json_parser_t *)user, value);
+}
+
+void json_parser_make_dom(json_parser_t *parser, json_t *json, unsigned flags) {
+    JSON_ASSERT(
+        !(flags & (JSON_LOAD_INSITU | JSON_LOAD_LAZY)),
+        "push parsers can't load in situ or lazily.\n"
+    );
+
+    json_sax_t sax;
+
+    sax.start_object = json_build_start_object;
+    sax.end_object = json_build_end_container;
+    sax.start_array = json_build_start_array;
+    sax.end_array = json_build_end_container;
+    sax.key = json_build_key;
+    sax.string = json_build_string;
+    sax.number = json_build_number;
+    sax.integer = json_build_integer;
+    sax.boolean = json_build_boolean;
+    sax.null = json_build_null;
+    sax.user = parser;
+
+    json_load_begin(json, 0, flags);
+
+    sax.allocator = &json->allocator;
+    json_parser_make(parser, &sax);
+
+    // strings go straight to json_t pages
+    parser->json = json;
+    parser->build = json->scratch;
+    parser->build_cap = json->scratch_cap;
+    parser->build_frame = JSON_NO_FRAME;
+    parser->key = NULL;
+    parser->key_len = 0;
+    parser->intern = flags & JSON_LOAD_INTERN;
+
+    json->scratch = NULL;
+    json->scratch_cap = 0;
+}
+
+// sax =========================================================================
+
+bool json_sax_parse(const json_sax_t *sax, const char *text, size_t len) {
+    json_parser_t parser;
+
+    json_parser_make(&parser, sax);
+    parser.last = true;
+    json_parser_feed(&parser, text, len);
+
+    return json_parser_finish(&parser);
+}
+
+bool json_sax_parse_file(const json_sax_t *sax, const char *filepath) {
+    char *text;
+    size_t len;
+    bool mapped = json_open_file(filepath, false, &text, &len);
+    bool finished = json_sax_parse(sax, text, len);
+
+    json_close_file(text, len, mapped);
+
+    return finished;
+}
+
+// serialization api ===========================================================
+
+// same as JSON_ESCAPE_CHARACTERS_X but without solidus ('/') as it is not required to be escaped
+#define JSON_SERIALIZE_ESCAPE_CHARACTERS_X\
+    X('"', '\"')\
+    X('\\', '\\')\
+    X('b', '\b')\
+    X('f', '\f')\
+    X('n', '\n')\
+    X('r', '\r')\
+    X('t', '\t')
+
+#ifndef JSON_SINK_BUF_SIZE
+#define JSON_SINK_BUF_SIZE 65536
+#endif
+
+#define JSON_STRINGY_INIT_CAP 256
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+// appends up to this size are counted on the spill, longer ones directly
+#define JSON_SPILL_SIZE 256
+
+// string builder. with a sink, str is a fixed buffer which is flushed to the
+// sink whenever it fills up. a fixed stringy writes to a caller's buffer, and
+// once that's full keeps counting on spill
+typedef struct json_stringy {
+    const json_allocator_t *allocator;
+    char *str;
+    size_t pos, cap;
+    size_t flushed; // bytes before str[0]
+
+    const json_sink_t *sink;
+    bool fixed;
+    // a sink write failed or a fixed buffer filled up, everything after it is
+    // only counted
+    bool failed;
+    char spill[JSON_SPILL_SIZE];
+} json_stringy_t;
+
+// container being written, and the index of its next child
+typedef struct json_serialize_frame {
+    json_object_t *object;
+    size_t index;
+} json_serialize_frame_t;
+
+// levels of frames a serializer holds itself, deeper json moves them to the
+// heap
+#define JSON_SERIALIZE_FRAMES 32
+
+// serialization context
+typedef struct json_serializer {
+    json_stringy_t stringy;
+    int level;
+
+    // open containers, one frame per level. stack is frames until it grows
+    const json_allocator_t *allocator;
+    json_serialize_frame_t frames[JSON_SERIALIZE_FRAMES];
+    json_serialize_frame_t *stack;
+    size_t stack_cap;
+
+    int indent, nlwidth;
+    bool mini;
+} json_serializer_t;
+
+static void json_stringy_make(
+    json_stringy_t *stringy, const json_allocator_t *allocator,
+    const json_sink_t *sink
+) {
+    stringy->allocator = allocator;
+    stringy->cap = sink ? JSON_SINK_BUF_SIZE : JSON_STRINGY_INIT_CAP;
+    stringy->str = (char *)json_alloc(allocator, stringy->cap);
+    stringy->pos = stringy->flushed = 0;
+    stringy->sink = sink;
+    stringy->fixed = stringy->failed = false;
+}
+
+static inline void json_stringy_kill(json_stringy_t *stringy) {
+    if (!stringy->fixed)
+        json_release(stringy->allocator, stringy->str, stringy->cap);
+}
+
+// passes len bytes on to the sink, without one they're only counted
+static void json_stringy_write(
+    json_stringy_t *stringy, const char *str, size_t len
+) {
+    stringy->flushed += len;
+
+    if (stringy->sink && len && !stringy->failed)
+        stringy->failed = !stringy->sink->write(stringy->sink->user, str, len);
+}
+
+static void json_stringy_flush(json_stringy_t *stringy) {
+    json_stringy_write(stringy, stringy->str, stringy->pos);
+    stringy->pos = 0;
+}
+
+// makes room for len more bytes, growing the buffer until it fits. a sink's
+// buffer is flushed instead, and may still be too small for len bytes. a full
+// fixed buffer is swapped for the spill
+static void json_stringy_reserve(json_stringy_t *stringy, size_t len) {
+    if (stringy->fixed) {
+        stringy->failed = true;
+        stringy->flushed += stringy->pos;
+        stringy->str = stringy->spill;
+        stringy->pos = 0;
+        stringy->cap = sizeof(stringy->spill);
+
+        return;
+    }
+
+    if (stringy->sink) {
+        json_stringy_flush(stringy);
+
+        return;
+    }
+
+    size_t cap = stringy->cap;
+
+    while (stringy->pos + len > cap)
+        cap <<= 1;
+
+    stringy->str = (char *)json_resize(
+        stringy->allocator,
+        stringy->str,
+        stringy->cap,
+        cap
+    );
+    stringy->cap = cap;
+}
+
+static void json_stringy_make_fixed(
+    json_stringy_t *stringy, char *buf, size_t cap
+) {
+    stringy->allocator = NULL;
+    stringy->str = buf;
+    stringy->cap = cap;
+    stringy->pos = stringy->flushed = 0;
+    stringy->sink = NULL;
+    stringy->fixed = true;
+    stringy->failed = false;
+
+    // nothing fits, buf may be NULL
+    if (!cap)
+        json_stringy_reserve(stringy, 0);
+}
+
+static inline void json_stringy_append(
+    json_stringy_t *stringy, const char *str, size_t len
+) {
+    if (stringy->pos + len > stringy->cap) {
+        json_stringy_reserve(stringy, len);
+
+        // too big to buffer, goes straight to the sink
+        if (len > stringy->cap) {
+            json_stringy_write(stringy, str, len);
+
+            return;
+        }
+    }
+
+    memcpy(stringy->str + stringy->pos, str, len);
+    stringy->pos += len;
+}
+
+static const char json_digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+// writes integer to buf without a terminator, returns the length. buf must
+// hold at least 20 characters
+static size_t json_itoa(char *buf, int64_t integer) {
+    char digits[20];
+    char *end = digits + sizeof(digits), *iter = end;
+    uint64_t value = integer < 0 ? 0 - (uint64_t)integer : (uint64_t)integer;
+
+    // two digits at a time, back to front
+    while (value >= 100) {
+        const char *pair = json_digit_pairs + (value % 100) * 2;
+
+        value /= 100;
+        *--iter = pair[1];
+        *--iter = pair[0];
+    }
+
+    if (value >= 10) {
+        const char *pair = json_digit_pairs + value * 2;
+
+        *--iter = pair[1];
+        *--iter = pair[0];
+    } else {
+        *--iter = (char)('0' + value);
+    }
+
+    size_t len = 0;
+
+    if (integer < 0)
+        buf[len++] = '-';
+
+    memcpy(buf + len, iter, (size_t)(end - iter));
+
+    return len + (size_t)(end - iter);
+}
+
+// returns the escape letter for ch, or 0 if ch is written as it is
+static inline char json_escape_letter(char ch) {
+    switch (ch) {
+#define X(a, b) case b: return a;
+    JSON_SERIALIZE_ESCAPE_CHARACTERS_X
+#undef X
+    default:
+        return 0;
+    }
+}
+
+// runs without quotes, backslashes or control characters are found the same
+// way the parser finds them, and copied in one go
+static void json_serialize_string(json_serializer_t *ser_ctx, char *str) {
+    json_stringy_t *stringy = &ser_ctx->stringy;
+    size_t len = strlen(str), index = 0;
+
+    json_stringy_append(stringy, "\"", 1);
+
+    while (1) {
+        size_t run_index = index;
+
+        index = json_scan_string(str, index, len);
+        json_stringy_append(stringy, str + run_index, index - run_index);
+
+        if (index == len)
+            break;
+
+        char escape[2] = {'\\', json_escape_letter(str[index])};
+
+        if (escape[1])
+            json_stringy_append(stringy, escape, 2);
+        else
+            json_stringy_append(stringy, str + index, 1);
+
+        ++index;
+    }
+
+    json_stringy_append(stringy, "\"", 1);
+}
+
+static const char json_spaces[] =
+    "                                                                ";
+
+static inline void json_serialize_indent(json_serializer_t *ser_ctx) {
+    if (ser_ctx->mini)
+        return;
+
+    size_t indent = (size_t)ser_ctx->level * (size_t)ser_ctx->indent;
+
+    while (indent) {
+        size_t len = indent < sizeof(json_spaces) - 1
+            ? indent : sizeof(json_spaces) - 1;
+
+        json_stringy_append(&ser_ctx->stringy, json_spaces, len);
+        indent -= len;
+    }
+}
+
+// doubles are written with grisu2 (Florian Loitsch, "Printing Floating-Point
+// Numbers Quickly and Accurately with Integers"), laid out like Milo Yip's
+// version of it. the digits always read back as the same double and are
+// nearly always the shortest ones that do
+
+// a 64 bit significand and binary exponent, f * 2^e
+typedef struct json_diyfp {
+    uint64_t f;
+    int e;
+} json_diyfp_t;
+
+#define JSON_DBL_HIDDEN_BIT ((uint64_t)1 << 52)
+
+static inline json_diyfp_t json_diyfp(uint64_t f, int e) {
+    json_diyfp_t fp;
+
+    fp.f = f;
+    fp.e = e;
+
+    return fp;
+}
+
+// upper 64 bits of the product, rounded
+static inline json_diyfp_t json_diyfp_mul(json_diyfp_t a, json_diyfp_t b) {
+    const uint64_t mask = 0xffffffff;
+    uint64_t a_hi = a.f >> 32, a_lo = a.f & mask;
+    uint64_t b_hi = b.f >> 32, b_lo = b.f & mask;
+    uint64_t hh = a_hi * b_hi, lh = a_lo * b_hi, hl = a_hi * b_lo;
+    uint64_t ll = a_lo * b_lo;
+    uint64_t mid = (ll >> 32) + (hl & mask) + (lh & mask) + ((uint64_t)1 << 31);
+
+    return json_diyfp(
+        hh + (hl >> 32) + (lh >> 32) + (mid >> 32),
+        a.e + b.e + 64
+    );
+}
+
+static inline json_diyfp_t json_diyfp_normalize(json_diyfp_t fp) {
+    while (!(fp.f >> 63)) {
+        fp.f <<= 1;
+        --fp.e;
+    }
+
+    return fp;
+}
+
+// 10^(8i - 348) as normalized diyfps, for i in [0, 87)
+static const uint64_t json_cached_pow10_f[] = {
+    0xfa8fd5a0081c0288, 0xbaaee17fa23ebf76, 0x8b16fb203055ac76,
+    0xcf42894a5dce35ea, 0x9a6bb0aa55653b2d, 0xe61acf033d1a45df,
+    0xab70fe17c79ac6ca, 0xff77b1fcbebcdc4f, 0xbe5691ef416bd60c,
+    0x8dd01fad907ffc3c, 0xd3515c2831559a83, 0x9d71ac8fada6c9b5,
+    0xea9c227723ee8bcb, 0xaecc49914078536d, 0x823c12795db6ce57,
+    0xc21094364dfb5637, 0x9096ea6f3848984f, 0xd77485cb25823ac7,
+    0xa086cfcd97bf97f4, 0xef340a98172aace5, 0xb23867fb2a35b28e,
+    0x84c8d4dfd2c63f3b, 0xc5dd44271ad3cdba, 0x936b9fcebb25c996,
+    0xdbac6c247d62a584, 0xa3ab66580d5fdaf6, 0xf3e2f893dec3f126,
+    0xb5b5ada8aaff80b8, 0x87625f056c7c4a8b, 0xc9bcff6034c13053,
+    0x964e858c91ba2655, 0xdff9772470297ebd, 0xa6dfbd9fb8e5b88f,
+    0xf8a95fcf88747d94, 0xb94470938fa89bcf, 0x8a08f0f8bf0f156b,
+    0xcdb02555653131b6, 0x993fe2c6d07b7fac, 0xe45c10c42a2b3b06,
+    0xaa242499697392d3, 0xfd87b5f28300ca0e, 0xbce5086492111aeb,
+    0x8cbccc096f5088cc, 0xd1b71758e219652c, 0x9c40000000000000,
+    0xe8d4a51000000000, 0xad78ebc5ac620000, 0x813f3978f8940984,
+    0xc097ce7bc90715b3, 0x8f7e32ce7bea5c70, 0xd5d238a4abe98068,
+    0x9f4f2726179a2245, 0xed63a231d4c4fb27, 0xb0de65388cc8ada8,
+    0x83c7088e1aab65db, 0xc45d1df942711d9a, 0x924d692ca61be758,
+    0xda01ee641a708dea, 0xa26da3999aef774a, 0xf209787bb47d6b85,
+    0xb454e4a179dd1877, 0x865b86925b9bc5c2, 0xc83553c5c8965d3d,
+    0x952ab45cfa97a0b3, 0xde469fbd99a05fe3, 0xa59bc234db398c25,
+    0xf6c69a72a3989f5c, 0xb7dcbf5354e9bece, 0x88fcf317f22241e2,
+    0xcc20ce9bd35c78a5, 0x98165af37b2153df, 0xe2a0b5dc971f303a,
+    0xa8d9d1535ce3b396, 0xfb9b7cd9a4a7443c, 0xbb764c4ca7a44410,
+    0x8bab8eefb6409c1a, 0xd01fef10a657842c, 0x9b10a4e5e9913129,
+    0xe7109bfba19c0c9d, 0xac2820d9623bf429, 0x80444b5e7aa7cf85,
+    0xbf21e44003acdd2d, 0x8e679c2f5e44ff8f, 0xd433179d9c8cb841,
+    0x9e19db92b4e31ba9, 0xeb96bf6ebadf77d9, 0xaf87023b9bf0ee6b
+};
+
+static const int16_t json_cached_pow10_e[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954,
+    -927, -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635,
+    -608, -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316,
+    -289, -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30, 56,
+    83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348, 375, 402, 428, 455,
+    481, 508, 534, 561, 588, 614, 641, 667, 694, 720, 747, 774, 800, 827, 853,
+    880, 907, 933, 960, 986, 1013, 1039, 1066
+};
+
+// picks a power of ten bringing a diyfp with exponent e into [-60, -32],
+// k is the decimal exponent it scales by
+static json_diyfp_t json_cached_pow10(int e, int *k) {
+    // 0.30102999566398114 is log10(2)
+    double dk = (-61 - e) * 0.30102999566398114 + 347;
+    int ik = (int)dk;
+
+    if (dk - ik > 0.0)
+        ++ik;
+
+    size_t index = (size_t)((ik >> 3) + 1);
+
+    *k = -(-348 + (int)index * 8);
+
+    return json_diyfp(json_cached_pow10_f[index], json_cached_pow10_e[index]);
+}
+
+static inline void json_grisu_round(
+    char *digits, size_t len, uint64_t delta, uint64_t rest,
+    uint64_t ten_kappa, uint64_t wp_w
+) {
+    while (rest < wp_w && delta - rest >= ten_kappa
+        && (rest + ten_kappa < wp_w
+         || wp_w - rest > rest + ten_kappa - wp_w)) {
+        --digits[len - 1];
+        rest += ten_kappa;
+    }
+}
+
+static const uint64_t json_pow10_u64[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+    100000000ull, 1000000000ull, 10000000000ull, 100000000000ull,
+    1000000000000ull, 10000000000000ull, 100000000000000ull,
+    1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull
+};
+
+// generates the digits of w as short as the boundaries mp - delta and mp
+// allow, the value is digits * 10^k
+static size_t json_grisu_digits(
+    json_diyfp_t w, json_diyfp_t mp, uint64_t delta, char *digits, int *k
+) {
+    json_diyfp_t one = json_diyfp((uint64_t)1 << -mp.e, mp.e);
+    uint64_t wp_w = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    size_t len = 0;
+    int kappa = 1;
+
+    while (kappa < 10 && p1 >= json_pow10_u64[kappa])
+        ++kappa;
+
+    // integral part
+    while (kappa > 0) {
+        uint32_t pow10 = (uint32_t)json_pow10_u64[kappa - 1];
+        uint32_t digit = p1 / pow10;
+
+        p1 %= pow10;
+
+        if (digit || len)
+            digits[len++] = (char)('0' + digit);
+
+        --kappa;
+
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+
+        if (rest <= delta) {
+            *k += kappa;
+            json_grisu_round(
+                digits, len, delta, rest,
+                json_pow10_u64[kappa] << -one.e, wp_w
+            );
+
+            return len;
+        }
+    }
+
+    // fractional part
+    while (1) {
+        p2 *= 10;
+        delta *= 10;
+
+        char digit = (char)(p2 >> -one.e);
+
+        if (digit || len)
+            digits[len++] = (char)('0' + digit);
+
+        p2 &= one.f - 1;
+        --kappa;
+
+        if (p2 < delta) {
+            *k += kappa;
+            json_grisu_round(
+                digits, len, delta, p2, one.f,
+                -kappa < 20 ? wp_w * json_pow10_u64[-kappa] : 0
+            );
+
+            return len;
+        }
+    }
+}
+
+// shortest digits of a positive, finite double, which is digits * 10^k
+static size_t json_grisu2(double value, char *digits, int *k) {
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    int biased_e = (int)((bits >> 52) & 0x7ff);
+    uint64_t significand = bits & (JSON_DBL_HIDDEN_BIT - 1);
+    json_diyfp_t v = biased_e
+        ? json_diyfp(significand + JSON_DBL_HIDDEN_BIT, biased_e - 1075)
+        : json_diyfp(significand, -1074);
+
+    // the boundaries halfway to the neighbouring doubles
+    json_diyfp_t plus = json_diyfp((v.f << 1) + 1, v.e - 1);
+
+    while (!(plus.f & (JSON_DBL_HIDDEN_BIT << 1))) {
+        plus.f <<= 1;
+        --plus.e;
+    }
+
+    plus.f <<= 10;
+    plus.e -= 10;
+
+    json_diyfp_t minus = v.f == JSON_DBL_HIDDEN_BIT
+        ? json_diyfp((v.f << 2) - 1, v.e - 2)
+        : json_diyfp((v.f << 1) - 1, v.e - 1);
+
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    json_diyfp_t c_mk = json_cached_pow10(plus.e, k);
+    json_diyfp_t w = json_diyfp_mul(json_diyfp_normalize(v), c_mk);
+    json_diyfp_t wp = json_diyfp_mul(plus, c_mk);
+    json_diyfp_t wm = json_diyfp_mul(minus, c_mk);
+
+    ++wm.f;
+    --wp.f;
+
+    return json_grisu_digits(w, wp, wp.f - wm.f, digits, k);
+}
+
+// writes digits * 10^k as a json number, returns its length. plain notation is
+// used for exponents up to 21 and down to -6 like javascript, and integral
+// values don't get a fraction
+static size_t json_format_digits(char *buf, size_t len, int k) {
+    int point = (int)len + k; // digits before the decimal point
+
+    if (k >= 0 && point <= 21) {
+        // 1234e2 -> 123400
+        memset(buf + len, '0', (size_t)k);
+
+        return (size_t)point;
+    } else if (point > 0 && point <= 21) {
+        // 1234e-2 -> 12.34
+        memmove(buf + point + 1, buf + point, len - (size_t)point);
+        buf[point] = '.';
+
+        return len + 1;
+    } else if (point > -6 && point <= 0) {
+        // 1234e-6 -> 0.001234
+        size_t offset = (size_t)(2 - point);
+
+        memmove(buf + offset, buf, len);
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', offset - 2);
+
+        return len + offset;
+    }
+
+    // 1234e30 -> 1.234e33
+    if (len > 1) {
+        memmove(buf + 2, buf + 1, len - 1);
+        buf[1] = '.';
+        ++len;
+    }
+
+    buf[len++] = 'e';
+
+    return len + json_itoa(buf + len, point - 1);
+}
+
+// at most '-', 17 digits and "e-308", or 21 digits, or "0." and 5 zeros
+#define JSON_DOUBLE_MAX_LEN 32
+
+static void json_serialize_number(json_serializer_t *ser_ctx, double number) {
+    // json has no infinities or nans
+    if (number != number || number - number != 0) {
+        json_stringy_append(&ser_ctx->stringy, "null", 4);
+
+        return;
+    }
+
+    char buf[JSON_DOUBLE_MAX_LEN];
+    size_t len = 0;
+    uint64_t bits;
+
+    memcpy(&bits, &number, sizeof(bits));
+
+    if (bits >> 63) {
+        buf[len++] = '-';
+        number = -number;
+    }
+
+    if (number == 0) {
+        buf[len++] = '0';
+    } else {
+        int k;
+        size_t digits = json_grisu2(number, buf + len, &k);
+
+        len += json_format_digits(buf + len, digits, k);
+    }
+
+    json_stringy_append(&ser_ctx->stringy, buf, len);
+}
+
+static inline void json_serialize_int64(
+    json_serializer_t *ser_ctx, int64_t integer
+) {
+    char buf[20];
+
+    json_stringy_append(&ser_ctx->stringy, buf, json_itoa(buf, integer));
+}
+
+static void json_serialize_scalar(
+    json_serializer_t *ser_ctx, json_object_t *object
+) {
+    switch (object->type) {
+    case JSON_STRING:
+        json_serialize_string(ser_ctx, object->data.string);
+
+        break;
+    case JSON_NUMBER:
+        if (object->is_int)
+            json_serialize_int64(ser_ctx, object->data.integer);
+        else
+            json_serialize_number(ser_ctx, object->data.number);
+
+        break;
+    case JSON_TRUE:
+        json_stringy_append(&ser_ctx->stringy, "true", 4);
+
+        break;
+    case JSON_FALSE:
+        json_stringy_append(&ser_ctx->stringy, "false", 5);
+
+        break;
+    case JSON_NULL:
+        json_stringy_append(&ser_ctx->stringy, "null", 4);
+
+        break;
+    default:
+        break;
+    }
+}
+
+// writes the opening of a container and pushes its frame
+static void json_serialize_open(
+    json_serializer_t *ser_ctx, json_object_t *object
+) {
+    if (ser_ctx->level == JSON_MAX_DEPTH)
+        JSON_ERROR("serialized json nested deeper than JSON_MAX_DEPTH.\n");
+
+    size_t level = (size_t)ser_ctx->level;
+
+    if (level == ser_ctx->stack_cap) {
+        size_t size = level * sizeof(json_serialize_frame_t);
+        json_serialize_frame_t *stack = (json_serialize_frame_t *)json_alloc(
+            ser_ctx->allocator,
+            size * 2
+        );
+
+        memcpy(stack, ser_ctx->stack, size);
+
+        if (ser_ctx->stack != ser_ctx->frames)
+            json_release(ser_ctx->allocator, ser_ctx->stack, size);
+
+        ser_ctx->stack = stack;
+        ser_ctx->stack_cap = level * 2;
+    }
+
+    json_serialize_frame_t *frame = &ser_ctx->stack[level];
+
+    frame->object = json_force(object);
+    frame->index = 0;
+
+    if (object->type == JSON_OBJECT)
+        json_stringy_append(&ser_ctx->stringy, "{\n", ser_ctx->nlwidth);
+    else
+        json_stringy_append(&ser_ctx->stringy, "[\n", ser_ctx->nlwidth);
+
+    ++ser_ctx->level;
+}
+
+// writes object depth first, with open containers on the serializer's stack
+// instead of the call stack
+static void json_serialize_value(
+    json_serializer_t *ser_ctx, json_object_t *object
+) {
+    int base = ser_ctx->level;
+
+    while (object) {
+        if (object->type == JSON_OBJECT || object->type == JSON_ARRAY)
+            json_serialize_open(ser_ctx, object);
+        else
+            json_serialize_scalar(ser_ctx, object);
+
+        // find the next child to write, closing every finished container
+        object = NULL;
+
+        while (!object && ser_ctx->level > base) {
+            json_serialize_frame_t *frame = &ser_ctx->stack[ser_ctx->level - 1];
+            json_object_t *container = frame->object;
+            bool members = container->type == JSON_OBJECT;
+            size_t size = members
+                ? container->data.hmap->size
+                : container->data.vec->size;
+
+            if (frame->index < size) {
+                size_t i = frame->index++;
+
+                if (i)
+                    json_stringy_append(&ser_ctx->stringy, ",\n", ser_ctx->nlwidth);
+
+                json_serialize_indent(ser_ctx);
+
+                if (members) {
+                    json_hmap_t *hmap = container->data.hmap;
+
+                    json_serialize_string(ser_ctx, hmap->keys[i]);
+                    json_stringy_append(&ser_ctx->stringy, ": ", ser_ctx->nlwidth);
+                    object = hmap->objects[i];
+                } else {
+                    object = (json_object_t *)container->data.vec->data[i];
+                }
+
+                continue;
+            }
+
+            if (!ser_ctx->mini)
+                json_stringy_append(&ser_ctx->stringy, "\n", 1);
+
+            --ser_ctx->level;
+
+            json_serialize_indent(ser_ctx);
+            json_stringy_append(&ser_ctx->stringy, members ? "}" : "]", 1);
+        }
+    }
+}
+
+// ser_ctx->stringy is made by the caller
+static void json_serializer_make(
+    json_serializer_t *ser_ctx, bool mini, int indent
+) {
+    ser_ctx->level = 0;
+    ser_ctx->allocator = ser_ctx->stringy.allocator
+        ? ser_ctx->stringy.allocator : &json_default_allocator;
+    ser_ctx->stack = ser_ctx->frames;
+    ser_ctx->stack_cap = JSON_SERIALIZE_FRAMES;
+    ser_ctx->indent = indent;
+    ser_ctx->mini = mini;
+    ser_ctx->nlwidth = ser_ctx->mini ? 1 : 2;
+}
+
+// ends the output, returning its length without the terminator. buffered
+// strings are returned in *out_str, the stringy's own buffer shrunk to fit,
+// so the text is never copied
+static size_t json_serializer_done(json_serializer_t *ser_ctx, char **out_str) {
+    json_stringy_t *stringy = &ser_ctx->stringy;
+
+    if (ser_ctx->stack != ser_ctx->frames) {
+        json_release(
+            ser_ctx->allocator,
+            ser_ctx->stack,
+            ser_ctx->stack_cap * sizeof(*ser_ctx->stack)
+        );
+    }
+
+    json_stringy_append(stringy, "\n", 1);
+
+    if (stringy->sink) {
+        json_stringy_flush(stringy);
+        json_stringy_kill(stringy);
+
+        return stringy->flushed;
+    }
+
+    size_t len = stringy->flushed + stringy->pos;
+
+    json_stringy_append(stringy, "", 1);
+
+    if (!stringy->fixed) {
+        *out_str = (char *)json_resize(
+            stringy->allocator,
+            stringy->str,
+            stringy->cap,
+            len + 1
+        );
+    }
+
+    return len;
+}
+
+char *json_serialize(
+    json_object_t *object, bool mini, int indent, size_t *out_len
+) {
+    return json_serialize_alloc(
+        object,
+        mini,
+        indent,
+        out_len,
+        &json_default_allocator
+    );
+}
+
+char *json_serialize_alloc(
+    json_object_t *object, bool mini, int indent, size_t *out_len,
+    const json_allocator_t *allocator
+) {
+    if (!object)
+        JSON_ERROR("attempted to serialize a NULL object.\n");
+
+    // create and use serializer
+    json_serializer_t ser_ctx;
+
+    json_stringy_make(&ser_ctx.stringy, allocator, NULL);
+    json_serializer_make(&ser_ctx, mini, indent);
+    json_serialize_value(&ser_ctx, object);
+
+    char *serialized;
+    size_t len = json_serializer_done(&ser_ctx, &serialized);
+
+    if (out_len)
+        *out_len = len;
+
+    return serialized;
+}
+
+size_t json_serialize_into(
+    char *buf, size_t cap, json_object_t *object, bool mini, int indent
+) {
+    if (!object)
+        JSON_ERROR("attempted to serialize a NULL object.\n");
+
+    json_serializer_t ser_ctx;
+
+    json_stringy_make_fixed(&ser_ctx.stringy, buf, cap);
+    json_serializer_make(&ser_ctx, mini, indent);
+    json_serialize_value(&ser_ctx, object);
+
+    size_t len = json_serializer_done(&ser_ctx, NULL);
+
+    if (len >= cap && cap)
+        buf[0] = '\0';
+
+    return len;
+}
+
+size_t json_serialized_size(json_object_t *object, bool mini, int indent) {
+    return json_serialize_into(NULL, 0, object, mini, indent);
+}
+
+bool json_serialize_to(
+    json_object_t *object, bool mini, int indent, const json_sink_t *sink
+) {
+    if (!object)
+        JSON_ERROR("attempted to serialize a NULL object.\n");
+
+    json_serializer_t ser_ctx;
+
+    json_stringy_make(&ser_ctx.stringy, &json_default_allocator, sink);
+    json_serializer_make(&ser_ctx, mini, indent);
+    json_serialize_value(&ser_ctx, object);
+    json_serializer_done(&ser_ctx, NULL);
+
+    return !ser_ctx.stringy.failed;
+}
+
+static bool json_file_write(void *user, const char *data, size_t len) {
+    return fwrite(data, 1, len, (FILE *)user) == len;
+}
+
+json_sink_t json_file_sink(FILE *file) {
+    json_sink_t sink;
+
+    sink.write = json_file_write;
+    sink.user = file;
+
+    return sink;
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// the fd is stored in the user pointer itself
+static bool json_fd_write(void *user, const char *data, size_t len) {
+    int fd = (int)(intptr_t)user;
+
+    while (len) {
+        ssize_t written = write(fd, data, len);
+
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+
+            return false;
+        }
+
+        data += written;
+        len -= (size_t)written;
+    }
+
+    return true;
+}
+
+json_sink_t json_fd_sink(int fd) {
+    json_sink_t sink;
+
+    sink.write = json_fd_write;
+    sink.user = (void *)(intptr_t)fd;
+
+    return sink;
+}
+#endif
+
+// get/put/to api functions ====================================================
+
+#define JSON_ASSERT_PROPER_CAST(json_type)\
+    JSON_ASSERT(\
+        object->type == json_type,\
+        "attempted to cast %s to %s.\n",\
+        json_types[object->type], json_types[json_type]\
+    )
+
+#define JSON_ASSERT_THAWED(json)\
+    JSON_ASSERT(!(json)->frozen, "attempted to modify a frozen json_t.\n")
+
+static inline json_object_t *json_empty_object(json_t *json) {
+    JSON_ASSERT_THAWED(json);
+
+    json_object_t *object = (json_object_t *)json_page_alloc(
+        json,
+        sizeof(json_object_t)
+    );
+
+    object->is_int = false;
+    object->is_lazy = false;
+
+    return object;
+}
+
+json_object_t *json_get_object(json_object_t *object, char *key) {
+    JSON_ASSERT(
+        object->type == JSON_OBJECT,
+        "attempted to get child \"%s\" from a non-object.\n",
+        key
+    );
+
+    return json_hmap_get(json_force(object)->data.hmap, key);
+}
+
+json_object_t **json_get_array(
+    json_object_t *object, char *key, size_t *out_size
+) {
+    return json_to_array(json_get_object(object, key), out_size);
+}
+
+char *json_get_string(json_object_t *object, char *key) {
+    return json_to_string(json_get_object(object, key));
+}
+
+double json_get_number(json_object_t *object, char *key) {
+    return json_to_number(json_get_object(object, key));
+}
+
+int64_t json_get_int64(json_object_t *object, char *key) {
+    return json_to_int64(json_get_object(object, key));
+}
+
+bool json_get_bool(json_object_t *object, char *key) {
+    return json_to_bool(json_get_object(object, key));
+}
+
+char **json_get_keys(json_object_t *object, size_t *out_size) {
+    json_hmap_t *hmap = json_force(object)->data.hmap;
+
+    if (out_size)
+        *out_size = hmap->size;
+
+    return hmap->keys;
+}
+
+json_object_t **json_to_array(json_object_t *object, size_t *out_size) {
+    JSON_ASSERT_PROPER_CAST(JSON_ARRAY);
+
+    json_vec_t *vec = json_force(object)->data.vec;
+
+    if (out_size)
+        *out_size = vec->size;
+
+    return (json_object_t **)vec->data;
+}
+
+char *json_to_string(json_object_t *object) {
+    JSON_ASSERT_PROPER_CAST(JSON_STRING);
+
+    return object->data.string;
+}
+
+double json_to_number(json_object_t *object) {
+    JSON_ASSERT_PROPER_CAST(JSON_NUMBER);
+
+    if (object->is_int)
+        return (double)object->data.integer;
+
+    return object->data.number;
+}
+
+int64_t json_to_int64(json_object_t *object) {
+    JSON_ASSERT_PROPER_CAST(JSON_NUMBER);
+
+    if (object->is_int)
+        return object->data.integer;
+
+    return (int64_t)object->data.number;
+}
+
+bool json_to_bool(json_object_t *object) {
+    JSON_ASSERT(
+        object->type == JSON_TRUE || object->type == JSON_FALSE,
+        "attempted to cast %s to bool.\n",
+        json_types[object->type]
+    );
+
+    return object->type == JSON_TRUE;
+}
+
+json_object_t *json_pop(json_t *json, json_object_t *object, char *key) {
+    JSON_ASSERT_THAWED(json);
+
+    return json_hmap_del(json, json_force(object)->data.hmap, key, false);
+}
+
+json_object_t *json_pop_ordered(
+    json_t *json, json_object_t *object, char *key
+) {
+    JSON_ASSERT_THAWED(json);
+
+    return json_hmap_del(json, json_force(object)->data.hmap, key, true);
+}
+
+json_object_t *json_new_object(json_t *json) {
+    json_object_t *object = json_empty_object(json);
+
+    object->type = JSON_OBJECT;
+    object->data.hmap = json_hmap_alloc(json, 0, NULL);
+
+    return object;
+}
+
+json_object_t *json_new_array(
+    json_t *json, json_object_t **objects, size_t size
+) {
+    json_object_t *object = json_empty_object(json);
+
+    object->type = JSON_ARRAY;
+    object->data.vec = json_vec_alloc(json, size, NULL);
+
+    for (size_t i = 0; i < size; ++i)
+        object->data.vec->data[i] = objects[i];
+
+    return object;
+}
+
+json_object_t *json_new_string(json_t *json, char *string) {
+    json_object_t *object = json_empty_object(json);
+
+    object->type = JSON_STRING;
+    object->data.string = json_page_alloc_str(json, strlen(string));
+
+    strcpy(object->data.string, string);
+
+    return object;
+}
+
+json_object_t *json_new_number(json_t *json, double number) {
+    json_object_t *object = json_empty_object(json);
+
+    object->type = JSON_NUMBER;
+    object->data.number = number;
+
+    return object;
+}
+
+json_object_t *json_new_int64(json_t *json, int64_t integer) {
+    json_object_t *object = json_empty_object(json);
+
+    object->type = JSON_NUMBER;
+    object->is_int = true;
+    object->data.integer = integer;
+
+    return object;
+}
+
+json_object_t *json_new_bool(json_t *json, bool value) {
+    json_object_t *object = json_empty_object(json);
+
+    object->type = value ? JSON_TRUE : JSON_FALSE;
+
+    return object;
+}
+
+json_object_t *json_new_null(json_t *json) {
+    json_object_t *object = json_empty_object(json);
+
+    object->type = JSON_NULL;
+
+    return object;
+}
+
+// container being copied, and the index of its next child
+typedef struct json_copy_frame {
+    json_object_t *object;
+    json_object_t *values; // copies of its children
+    size_t index;
+} json_copy_frame_t;
+
+// copies object into copied without its children. containers get a block for
+// them, which is returned, and maps have their keys added straight away
+static json_object_t *json_copy_shallow(
+    json_t *json, json_object_t *copied, json_object_t *object
+) {
+    json_object_t *values = NULL;
+
+    copied->type = object->type;
+    copied->is_int = object->is_int;
+    copied->is_lazy = false;
+
+    switch (copied->type) {
+    case JSON_OBJECT: {
+        json_hmap_t *hmap = json_force(object)->data.hmap;
+
+        copied->data.hmap = json_hmap_alloc(json, hmap->size, &values);
+
+        // keys are already unique
+        for (size_t i = 0; i < hmap->size; ++i) {
+            json_hmap_append(
+                json,
+                copied->data.hmap,
+                hmap->keys[i],
+                hmap->lens[i],
+                hmap->hashes[i],
+                &values[i]
+            );
+        }
+
+        break;
+    }
+    case JSON_ARRAY:
+        copied->data.vec = json_vec_alloc(
+            json,
+            json_force(object)->data.vec->size,
+            &values
+        );
+
+        break;
+    case JSON_STRING: {
+        // allocate new string and copy
+        char *string = object->data.string;
+
+        // TODO store string lengths for objects?
+        copied->data.string = json_page_alloc_str(json, strlen(string));
+
+        strcpy(copied->data.string, string);
+
+        break;
+    }
+    default:
+        copied->data = object->data;
+
+        break;
+    }
+
+    return values;
+}
+
+// copies object into copied, children are copied into the same blocks as
+// their containers. the tree is walked depth first with open containers on a
+// heap stack rather than by recursing
+static void json_copy_into(
+    json_t *json, json_object_t *copied, json_object_t *object
+) {
+    char *stack = NULL;
+    size_t stack_cap = 0, depth = 0;
+
+    while (object) {
+        json_object_t *values = json_copy_shallow(json, copied, object);
+
+        if (values) {
+            if (depth == JSON_MAX_DEPTH)
+                JSON_ERROR("copied json nested deeper than JSON_MAX_DEPTH.\n");
+
+            json_buf_reserve(
+                &json->allocator,
+                &stack,
+                &stack_cap,
+                (depth + 1) * sizeof(json_copy_frame_t)
+            );
+
+            json_copy_frame_t *frame = (json_copy_frame_t *)stack + depth++;
+
+            frame->object = object;
+            frame->values = values;
+            frame->index = 0;
+        }
+
+        // find the next child to copy, leaving every finished container
+        object = NULL;
+
+        while (!object && depth) {
+            json_copy_frame_t *frame = (json_copy_frame_t *)stack + depth - 1;
+            json_object_t *container = frame->object;
+            size_t size = container->type == JSON_OBJECT
+                ? container->data.hmap->size
+                : container->data.vec->size;
+
+            if (frame->index == size) {
+                --depth;
+                continue;
+            }
+
+            size_t i = frame->index++;
+
+            copied = &frame->values[i];
+            object = container->type == JSON_OBJECT
+                ? container->data.hmap->objects[i]
+                : (json_object_t *)container->data.vec->data[i];
+        }
+    }
+
+    if (stack)
+        json_release(&json->allocator, stack, stack_cap);
+}
+
+json_object_t *json_copy(json_t *json, json_object_t *object) {
+    json_object_t *copied = json_empty_object(json);
+
+    json_copy_into(json, copied, object);
+
+    return copied;
+}
+
+void json_put(
+    json_t *json, json_object_t *object, char *key, json_object_t *child
+) {
+    JSON_ASSERT_THAWED(json);
+    JSON_ASSERT(
+        object->type == JSON_OBJECT,
+        "called put_object on a non-object.\n"
+    );
+
+    json_hmap_put(json, json_force(object)->data.hmap, key, child);
+}
+
+void json_put_copy(
+    json_t *json, json_object_t *object, char *key, json_object_t *child
+) {
+    json_put(json, object, key, json_copy(json, child));
+}
 
 json_object_t *json_put_object(
     json_t *json, json_object_t *object, char *key
 ) {
-    json_object_t *child = json_new_object(json);
+    json_object_t *child = json_new_object(json);
+
+    json_put(json, object, key, child);
+
+    return child;
+}
+
+void json_put_array(
+    json_t *json, json_object_t *object, char *key,
+    json_object_t **objects, size_t size
+) {
+    json_put(json, object, key, json_new_array(json, objects, size));
+}
+
+void json_put_string(
+    json_t *json, json_object_t *object, char *key, char *string
+) {
+    json_put(json, object, key, json_new_string(json, string));
+}
+
+void json_put_number(
+    json_t *json, json_object_t *object, char *key, double number
+) {
+    json_put(json, object, key, json_new_number(json, number));
+}
+
+void json_put_int64(
+    json_t *json, json_object_t *object, char *key, int64_t integer
+) {
+    json_put(json, object, key, json_new_int64(json, integer));
+}
+
+void json_put_bool(json_t *json, json_object_t *object, char *key, bool value) {
+    json_put(json, object, key, json_new_bool(json, value));
+}
+
+void json_put_null(json_t *json, json_object_t *object, char *key) {
+    json_put(json, object, key, json_new_null(json));
+}
+
+// sharing =====================================================================
+
+// container being forced, and the index of its next child
+typedef struct json_force_frame {
+    json_object_t *object;
+    size_t index;
+} json_force_frame_t;
+
+// makes sure nothing under object is lazy, depth first with open containers on
+// a heap stack rather than by recursing
+static void json_force_tree(json_object_t *object) {
+    char *stack = NULL;
+    size_t stack_cap = 0, depth = 0;
+
+    while (object) {
+        if (object->type == JSON_OBJECT || object->type == JSON_ARRAY) {
+            if (depth == JSON_MAX_DEPTH)
+                JSON_ERROR("forced json nested deeper than JSON_MAX_DEPTH.\n");
+
+            json_buf_reserve(
+                &json_default_allocator,
+                &stack,
+                &stack_cap,
+                (depth + 1) * sizeof(json_force_frame_t)
+            );
+
+            json_force_frame_t *frame = (json_force_frame_t *)stack + depth++;
+
+            frame->object = json_force(object);
+            frame->index = 0;
+        }
+
+        // find the next child, leaving every finished container
+        object = NULL;
+
+        while (!object && depth) {
+            json_force_frame_t *frame = (json_force_frame_t *)stack + depth - 1;
+            json_object_t *container = frame->object;
+            size_t size = container->type == JSON_OBJECT
+                ? container->data.hmap->size
+                : container->data.vec->size;
+
+            if (frame->index == size) {
+                --depth;
+                continue;
+            }
+
+            size_t i = frame->index++;
+
+            object = container->type == JSON_OBJECT
+                ? container->data.hmap->objects[i]
+                : (json_object_t *)container->data.vec->data[i];
+        }
+    }
+
+    if (stack)
+        json_release(&json_default_allocator, stack, stack_cap);
+}
+
+void json_freeze(json_t *json) {
+    if (json->root)
+        json_force_tree(json->root);
+
+    json->frozen = true;
+}
+
+json_object_t *json_graft(
+    json_t *json, json_object_t *object, char *key, json_t *src
+) {
+    json_object_t *root = src->root;
+
+    JSON_ASSERT(root, "attempted to graft an empty json_t.\n");
+
+    // lazy spans parse onto the json_t they were loaded on, so they have to be
+    // parsed before src goes away
+    json_force_tree(root);
+    json_absorb(json, src);
+    json_put(json, object, key, root);
+
+    return root;
+}
+
+// paths =======================================================================
+
+char *json_intern(json_t *json, const char *str) {
+    JSON_ASSERT_THAWED(json);
+
+    size_t len;
+    json_hash_t hash = json_hash_str(str, &len);
+
+    return json_intern_mem(json, str, len, hash);
+}
+
+json_key_t json_key_make(const char *str) {
+    json_key_t key;
+
+    key.str = str;
+    key.hash = json_hash_str(str, &key.len);
+
+    return key;
+}
+
+json_object_t *json_key_get(json_object_t *object, const json_key_t *key) {
+    JSON_ASSERT(
+        object->type == JSON_OBJECT,
+        "attempted to get child \"%s\" from a non-object.\n",
+        key->str
+    );
+
+    return json_hmap_get_hashed(
+        json_force(object)->data.hmap,
+        key->str,
+        key->len,
+        key->hash
+    );
+}
+
+// array indices are decimal without leading zeros
+static size_t json_path_index(const char *str, size_t len) {
+    if (!len || len > 19 || (str[0] == '0' && len > 1))
+        return SIZE_MAX;
+
+    uint64_t index = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        if (!json_is_digit(str[i]))
+            return SIZE_MAX;
+
+        index = index * 10 + (uint64_t)(str[i] - '0');
+    }
+
+    return index < SIZE_MAX ? (size_t)index : SIZE_MAX;
+}
+
+void json_path_make(json_path_t *path, const char *pointer) {
+    if (*pointer && *pointer != '/')
+        JSON_ERROR("json pointer must start with '/': \"%s\"\n", pointer);
+
+    size_t count = 0, len = strlen(pointer);
+
+    for (size_t i = 0; i < len; ++i)
+        count += pointer[i] == '/';
+
+    // the unescaped keys are never longer than the pointer
+    size_t steps_size = count * sizeof(json_path_step_t);
+    char *block = (char *)json_fat_alloc(
+        &json_default_allocator,
+        steps_size + len + 1
+    );
+    char *keys = block + steps_size;
+
+    path->steps = (json_path_step_t *)block;
+    path->count = count;
+
+    const char *iter = pointer;
+
+    for (size_t i = 0; i < count; ++i) {
+        json_path_step_t *step = &path->steps[i];
+        char *key = keys;
+
+        // '~1' is '/' and '~0' is '~'
+        for (++iter; *iter && *iter != '/'; ++iter) {
+            if (*iter != '~') {
+                *keys++ = *iter;
+            } else if (iter[1] == '0' || iter[1] == '1') {
+                *keys++ = *++iter == '0' ? '~' : '/';
+            } else {
+                JSON_ERROR("invalid escape in json pointer: \"%s\"\n", pointer);
+            }
+        }
+
+        *keys++ = '\0';
+
+        step->key = json_key_make(key);
+        step->index = json_path_index(key, step->key.len);
+    }
+}
+
+void json_path_free(json_path_t *path) {
+    json_fat_free(&json_default_allocator, path->steps);
+}
+
+json_object_t *json_path_get(json_object_t *root, const json_path_t *path) {
+    json_object_t *object = root;
+
+    for (size_t i = 0; object && i < path->count; ++i) {
+        const json_path_step_t *step = &path->steps[i];
+
+        switch (object->type) {
+        case JSON_OBJECT:
+            object = json_hmap_get_hashed(
+                json_force(object)->data.hmap,
+                step->key.str,
+                step->key.len,
+                step->key.hash
+            );
+
+            break;
+        case JSON_ARRAY: {
+            json_vec_t *vec = json_force(object)->data.vec;
+
+            object = step->index < vec->size
+                ? (json_object_t *)vec->data[step->index]
+                : NULL;
+
+            break;
+        }
+        default:
+            return NULL;
+        }
+    }
+
+    return object;
+}
+
+// schemas =====================================================================
+
+// validates and steps over the string at ctx->index
+static void json_skip_string(json_ctx_t *ctx) {
+    if (json_peek(ctx) != '\"')
+        JSON_CTX_ERROR(ctx, "unknown token, expected string.\n");
+
+    ++ctx->index;
+
+    while (1) {
+        ctx->index = json_scan_string(ctx->text, ctx->index, ctx->len);
+
+        switch (json_peek(ctx)) {
+        case '\"':
+            ++ctx->index;
+
+            return;
+        case '\n':
+        case '\0':
+            JSON_CTX_ERROR(ctx, "string ended unexpectedly.\n");
+        default:
+            json_expect_str_char(ctx);
+        }
+    }
+}
+
+// validates and steps over the number at ctx->index, the same grammar as
+// json_expect_number() without converting anything
+static void json_skip_number(json_ctx_t *ctx) {
+    if (json_peek(ctx) == '-')
+        ++ctx->index;
+
+    if (!json_is_digit(json_peek(ctx)))
+        JSON_CTX_ERROR(ctx, "expected digit.\n");
+
+    while (json_is_digit(json_peek(ctx)))
+        ++ctx->index;
+
+    if (json_peek(ctx) == '.') {
+        ++ctx->index;
+
+        if (!json_is_digit(json_peek(ctx)))
+            JSON_CTX_ERROR(ctx, "expected digit.\n");
+
+        while (json_is_digit(json_peek(ctx)))
+            ++ctx->index;
+    }
+
+    if (json_peek(ctx) == 'e' || json_peek(ctx) == 'E') {
+        ++ctx->index;
+
+        if (json_peek(ctx) == '+' || json_peek(ctx) == '-')
+            ++ctx->index;
+
+        if (!json_is_digit(json_peek(ctx)))
+            JSON_CTX_ERROR(ctx, "expected digit.\n");
+
+        while (json_is_digit(json_peek(ctx)))
+            ++ctx->index;
+    }
+}
+
+// validates and steps over a string, number, boolean or null
+static void json_skip_scalar(json_ctx_t *ctx) {
+    switch (json_peek(ctx)) {
+    case '"':
+        json_skip_string(ctx);
+
+        break;
+    case 't':
+        json_expect_token(ctx, "true", 4);
+
+        break;
+    case 'f':
+        json_expect_token(ctx, "false", 5);
+
+        break;
+    case 'n':
+        json_expect_token(ctx, "null", 4);
+
+        break;
+    default:
+        if (json_is_digit(json_peek(ctx)) || json_peek(ctx) == '-') {
+            json_skip_number(ctx);
+
+            break;
+        }
+
+        JSON_CTX_ERROR(ctx, "unknown token, expected value.\n");
+    }
+}
+
+// validates and steps over a key and its ':'
+static void json_skip_key(json_ctx_t *ctx) {
+    json_skip_string(ctx);
+    json_next_token(ctx);
+    json_expect_token(ctx, ":", 1);
+    json_next_token(ctx);
+}
+
+// validates and steps over the value at ctx->index without keeping any of it.
+// containers are walked in a loop rather than recursively, with a bit per open
+// container for whether it's an object
+static void json_skip_value(json_ctx_t *ctx) {
+    uint64_t objects[(JSON_MAX_DEPTH + 63) / 64];
+    size_t depth = 0;
+
+    do {
+        char ch = json_peek(ctx);
+
+        if (ch == '{' || ch == '[') {
+            if (depth == JSON_MAX_DEPTH) {
+                JSON_CTX_ERROR_CODE(
+                    ctx,
+                    JSON_ERR_DEPTH,
+                    "json nested deeper than JSON_MAX_DEPTH.\n"
+                );
+            }
+
+            uint64_t bit = (uint64_t)1 << (depth % 64);
+
+            if (ch == '{')
+                objects[depth / 64] |= bit;
+            else
+                objects[depth / 64] &= ~bit;
+
+            ++depth;
+            ++ctx->index;
+            json_next_token(ctx);
+
+            if (json_peek(ctx) != (ch == '{' ? '}' : ']')) {
+                if (ch == '{')
+                    json_skip_key(ctx);
+
+                continue;
+            }
+        } else {
+            json_skip_scalar(ctx);
+        }
+
+        // step out of every container ending here
+        while (depth) {
+            bool object = objects[(depth - 1) / 64] >> ((depth - 1) % 64) & 1;
+
+            json_next_token(ctx);
+
+            if (json_peek(ctx) == (object ? '}' : ']')) {
+                ++ctx->index;
+                --depth;
+
+                continue;
+            }
+
+            json_expect_token(ctx, ",", 1);
+            json_next_token(ctx);
+
+            if (object)
+                json_skip_key(ctx);
+
+            break;
+        }
+    } while (depth);
+}
+
+static size_t json_field_size(
+    json_field_type_e type, const json_schema_t *schema
+) {
+    switch (type) {
+    case JSON_FIELD_BOOL: return sizeof(bool);
+    case JSON_FIELD_INT: return sizeof(int);
+    case JSON_FIELD_INT64: return sizeof(int64_t);
+    case JSON_FIELD_DOUBLE: return sizeof(double);
+    case JSON_FIELD_STRING: return sizeof(char *);
+    case JSON_FIELD_STRUCT: return schema->size;
+    default: JSON_ERROR("arrays of arrays can't be decoded into structs.\n");
+    }
+}
+
+// members usually come in schema order, so the search starts after the last
+// field found
+static const json_field_t *json_find_field(
+    const json_schema_t *schema, const char *key, size_t len, size_t *next
+) {
+    size_t index = *next;
+
+    for (size_t i = 0; i < schema->count; ++i, ++index) {
+        if (index >= schema->count)
+            index = 0;
+
+        const json_field_t *field = &schema->fields[index];
+
+        if (!strncmp(field->name, key, len) && !field->name[len]) {
+            *next = index + 1;
+
+            return field;
+        }
+    }
+
+    return NULL;
+}
+
+static void json_decode_struct(json_ctx_t *, const json_schema_t *, char *out);
+
+// decodes the value at ctx->index into out, as anything but JSON_FIELD_ARRAY
+static void json_decode_value(
+    json_ctx_t *ctx, json_field_type_e type, const json_schema_t *schema,
+    char *out
+) {
+    json_object_t number;
+    size_t len;
+
+    if (json_peek(ctx) == 'n') {
+        json_expect_token(ctx, "null", 4);
+
+        if (type == JSON_FIELD_STRING)
+            *(char **)out = NULL;
+
+        return;
+    }
+
+    switch (type) {
+    case JSON_FIELD_BOOL:
+        if (json_peek(ctx) == 't') {
+            json_expect_token(ctx, "true", 4);
+            *(bool *)out = true;
+        } else if (json_peek(ctx) == 'f') {
+            json_expect_token(ctx, "false", 5);
+            *(bool *)out = false;
+        } else {
+            JSON_CTX_ERROR(ctx, "unknown token, expected bool.\n");
+        }
+
+        break;
+    case JSON_FIELD_INT:
+    case JSON_FIELD_INT64:
+    case JSON_FIELD_DOUBLE: {
+        if (!json_is_digit(json_peek(ctx)) && json_peek(ctx) != '-')
+            JSON_CTX_ERROR(ctx, "unknown token, expected number.\n");
+
+        json_expect_number(ctx, &number);
+
+        // converted like json_to_int64() and json_to_number()
+        if (type == JSON_FIELD_DOUBLE) {
+            *(double *)out = number.is_int
+                ? (double)number.data.integer : number.data.number;
+
+            break;
+        }
+
+        int64_t integer = number.is_int
+            ? number.data.integer : (int64_t)number.data.number;
+
+        if (type == JSON_FIELD_INT64) {
+            *(int64_t *)out = integer;
+        } else if (integer >= INT_MIN && integer <= INT_MAX) {
+            *(int *)out = (int)integer;
+        } else {
+            JSON_CTX_ERROR(ctx, "number doesn't fit in an int.\n");
+        }
+
+        break;
+    }
+    case JSON_FIELD_STRING:
+        *(char **)out = json_expect_string(ctx, &len, NULL);
+
+        break;
+    case JSON_FIELD_STRUCT:
+        json_decode_struct(ctx, schema, out);
+
+        break;
+    case JSON_FIELD_ARRAY:
+        JSON_ERROR("arrays of arrays can't be decoded into structs.\n");
+    }
+}
+
+// elements are decoded into a temporary, nested arrays can move the scratch
+// stack they're collected on
+#define JSON_DECODE_ELEM_SIZE 256
+
+static void json_decode_array(
+    json_ctx_t *ctx, const json_field_t *field, char *out
+) {
+    char **elems = (char **)(out + field->offset);
+    size_t *count = (size_t *)(out + field->count_offset);
+
+    if (json_peek(ctx) == 'n') {
+        json_expect_token(ctx, "null", 4);
+        *elems = NULL;
+        *count = 0;
+
+        return;
+    }
+
+    if (json_peek(ctx) != '[')
+        JSON_CTX_ERROR(ctx, "unknown token, expected array.\n");
+
+    size_t size = json_field_size(field->elem, field->schema);
+    size_t stride = JSON_ALIGN(size);
+    size_t base = ctx->scratch_size;
+
+    uint64_t elem_buf[JSON_DECODE_ELEM_SIZE / sizeof(uint64_t)];
+    char *elem = size <= sizeof(elem_buf)
+        ? (char *)elem_buf : (char *)json_alloc(ctx->allocator, size);
+
+    ++ctx->index; // skip '['
+    json_next_token(ctx);
+
+    if (json_peek(ctx) != ']') {
+        while (1) {
+            memset(elem, 0, size);
+            json_decode_value(ctx, field->elem, field->schema, elem);
+            memcpy(json_scratch_push(ctx, stride), elem, size);
+
+            json_next_token(ctx);
+
+            if (json_peek(ctx) == ']')
+                break;
+
+            json_expect_token(ctx, ",", 1);
+            json_next_token(ctx);
+        }
+    }
+
+    ++ctx->index; // skip ']'
+
+    if (elem != (char *)elem_buf)
+        json_release(ctx->allocator, elem, size);
+
+    // move elements to their final block
+    size_t n = (ctx->scratch_size - base) / stride;
+
+    // [] still gets a pointer, NULL is json null
+    *elems = (char *)json_page_alloc(ctx->json, n * size);
+    *count = n;
+
+    if (stride == size && n) {
+        memcpy(*elems, ctx->scratch + base, n * size);
+    } else {
+        for (size_t i = 0; i < n; ++i)
+            memcpy(*elems + i * size, ctx->scratch + base + i * stride, size);
+    }
+
+    ctx->scratch_size = base;
+}
+
+static void json_decode_struct(
+    json_ctx_t *ctx, const json_schema_t *schema, char *out
+) {
+    if (json_peek(ctx) != '{')
+        JSON_CTX_ERROR(ctx, "unknown token, expected object.\n");
+
+    ++ctx->index; // skip '{'
+    json_next_token(ctx);
+
+    if (json_peek(ctx) != '}') {
+        size_t next = 0;
+
+        while (1) {
+            // keys are only needed until their field is found
+            size_t len;
+
+            ctx->transient = true;
+
+            char *key = json_expect_string(ctx, &len, NULL);
+            const json_field_t *field = json_find_field(
+                schema,
+                key,
+                len,
+                &next
+            );
+
+            ctx->transient = false;
+
+            json_next_token(ctx);
+            json_expect_token(ctx, ":", 1);
+            json_next_token(ctx);
+
+            if (!field)
+                json_skip_value(ctx);
+            else if (field->type == JSON_FIELD_ARRAY)
+                json_decode_array(ctx, field, out);
+            else
+                json_decode_value(
+                    ctx,
+                    field->type,
+                    field->schema,
+                    out + field->offset
+                );
+
+            json_next_token(ctx);
+
+            if (json_peek(ctx) == '}')
+                break;
+
+            json_expect_token(ctx, ",", 1);
+            json_next_token(ctx);
+        }
+    }
+
+    ++ctx->index; // skip '}'
+}
+
+void json_decode(
+    json_t *json, const json_schema_t *schema, void *out, char *text,
+    size_t len, unsigned flags
+) {
+    // there are no objects to reserve pages for
+    if (flags & JSON_LOAD_REUSE)
+        json_reset(json);
+    else
+        json_load_empty(json);
+
+    json_ctx_t ctx;
+
+    json_ctx_make(&ctx, json, text, len, flags & JSON_LOAD_INSITU);
+
+    json_next_token(&ctx);
+    json_decode_struct(&ctx, schema, (char *)out);
+
+    // only whitespace may follow the root
+    json_next_token(&ctx);
+
+    if (ctx.index != ctx.len)
+        JSON_CTX_ERROR(&ctx, "unexpected text after json root.\n");
+
+    json_ctx_done(&ctx);
+}
+
+static void json_encode_struct(
+    json_serializer_t *, const json_schema_t *, const char *in
+);
+
+static void json_encode_value(
+    json_serializer_t *ser_ctx, json_field_type_e type,
+    const json_schema_t *schema, const char *in
+) {
+    switch (type) {
+    case JSON_FIELD_BOOL:
+        if (*(const bool *)in)
+            json_stringy_append(&ser_ctx->stringy, "true", 4);
+        else
+            json_stringy_append(&ser_ctx->stringy, "false", 5);
+
+        break;
+    case JSON_FIELD_INT:
+        json_serialize_int64(ser_ctx, *(const int *)in);
+
+        break;
+    case JSON_FIELD_INT64:
+        json_serialize_int64(ser_ctx, *(const int64_t *)in);
+
+        break;
+    case JSON_FIELD_DOUBLE:
+        json_serialize_number(ser_ctx, *(const double *)in);
+
+        break;
+    case JSON_FIELD_STRING:
+        if (*(char *const *)in)
+            json_serialize_string(ser_ctx, *(char *const *)in);
+        else
+            json_stringy_append(&ser_ctx->stringy, "null", 4);
+
+        break;
+    case JSON_FIELD_STRUCT:
+        json_encode_struct(ser_ctx, schema, in);
+
+        break;
+    case JSON_FIELD_ARRAY:
+        JSON_ERROR("arrays of arrays can't be encoded from structs.\n");
+    }
+}
+
+static void json_encode_array(
+    json_serializer_t *ser_ctx, const json_field_t *field, const char *in
+) {
+    const char *elems = *(char *const *)(in + field->offset);
+    size_t count = *(const size_t *)(in + field->count_offset);
+
+    if (!elems) {
+        json_stringy_append(&ser_ctx->stringy, "null", 4);
+
+        return;
+    } else if (!count) {
+        json_stringy_append(&ser_ctx->stringy, "[]", 2);
+
+        return;
+    }
+
+    size_t size = json_field_size(field->elem, field->schema);
+
+    json_stringy_append(&ser_ctx->stringy, "[\n", ser_ctx->nlwidth);
+
+    ++ser_ctx->level;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (i)
+            json_stringy_append(&ser_ctx->stringy, ",\n", ser_ctx->nlwidth);
+
+        json_serialize_indent(ser_ctx);
+        json_encode_value(ser_ctx, field->elem, field->schema, elems + i * size);
+    }
+
+    if (!ser_ctx->mini)
+        json_stringy_append(&ser_ctx->stringy, "\n", 1);
+
+    --ser_ctx->level;
+
+    json_serialize_indent(ser_ctx);
+    json_stringy_append(&ser_ctx->stringy, "]", 1);
+}
+
+static void json_encode_struct(
+    json_serializer_t *ser_ctx, const json_schema_t *schema, const char *in
+) {
+    json_stringy_append(&ser_ctx->stringy, "{\n", ser_ctx->nlwidth);
+
+    ++ser_ctx->level;
+
+    for (size_t i = 0; i < schema->count; ++i) {
+        const json_field_t *field = &schema->fields[i];
+
+        if (i)
+            json_stringy_append(&ser_ctx->stringy, ",\n", ser_ctx->nlwidth);
+
+        json_serialize_indent(ser_ctx);
+        json_serialize_string(ser_ctx, (char *)field->name);
+        json_stringy_append(&ser_ctx->stringy, ": ", ser_ctx->nlwidth);
+
+        if (field->type == JSON_FIELD_ARRAY)
+            json_encode_array(ser_ctx, field, in);
+        else
+            json_encode_value(
+                ser_ctx,
+                field->type,
+                field->schema,
+                in + field->offset
+            );
+    }
+
+    if (!ser_ctx->mini)
+        json_stringy_append(&ser_ctx->stringy, "\n", 1);
+
+    --ser_ctx->level;
+
+    json_serialize_indent(ser_ctx);
+    json_stringy_append(&ser_ctx->stringy, "}", 1);
+}
+
+char *json_encode(
+    const json_schema_t *schema, const void *in, bool mini, int indent,
+    size_t *out_len
+) {
+    json_serializer_t ser_ctx;
+
+    json_stringy_make(&ser_ctx.stringy, &json_default_allocator, NULL);
+    json_serializer_make(&ser_ctx, mini, indent);
+    json_encode_struct(&ser_ctx, schema, (const char *)in);
+
+    char *encoded;
+    size_t len = json_serializer_done(&ser_ctx, &encoded);
+
+    if (out_len)
+        *out_len = len;
+
+    return encoded;
+}
+
+// validation ==================================================================
+
+static void json_validate_document(json_ctx_t *ctx) {
+    json_next_token(ctx);
+
+    // empty json is still valid json
+    if (ctx->index == ctx->len)
+        return;
+
+    if (json_peek(ctx) != '{' && json_peek(ctx) != '[')
+        JSON_CTX_ERROR(ctx, "invalid json root.\n");
+
+    json_skip_value(ctx);
+
+    // only whitespace may follow the root
+    json_next_token(ctx);
+
+    if (ctx->index != ctx->len)
+        JSON_CTX_ERROR(ctx, "unexpected text after json root.\n");
+}
+
+bool json_validate(const char *text, size_t len, json_error_t *error) {
+    json_error_t discarded;
+    json_ctx_t ctx;
+
+    json_ctx_make_bare(&ctx, text, len);
+
+    return json_try_parse(
+        &ctx,
+        json_validate_document,
+        error ? error : &discarded
+    );
+}
+
+// binary images ===============================================================
+
+#define JSON_IMAGE_MAGIC "ghhjson"
+#define JSON_IMAGE_VERSION 1
+
+typedef struct json_image_header {
+    char magic[8];
+    uint32_t version;
+    // native layout of the image, which has to match the loading machine's
+    uint16_t byte_order; // 0x0102 as written by the saving machine
+    uint8_t pointer_size, hash_size;
+    uint32_t object_size, hmap_size;
+
+    uint64_t size; // whole image, header included
+    uint64_t root; // offset of the root object, 0 for empty documents
+} json_image_header_t;
+
+typedef struct json_image_writer {
+    char *buf;
+    size_t size, cap;
+} json_image_writer_t;
+
+static inline json_image_header_t json_image_layout(void) {
+    json_image_header_t header;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JSON_IMAGE_MAGIC, sizeof(JSON_IMAGE_MAGIC));
+    header.version = JSON_IMAGE_VERSION;
+    header.byte_order = 0x0102;
+    header.pointer_size = (uint8_t)sizeof(void *);
+    header.hash_size = (uint8_t)sizeof(json_hash_t);
+    header.object_size = (uint32_t)sizeof(json_object_t);
+    header.hmap_size = (uint32_t)sizeof(json_hmap_t);
+
+    return header;
+}
+
+// returns the offset of size zeroed bytes at the end of the image
+static size_t json_image_reserve(
+    json_image_writer_t *writer, size_t size, size_t align
+) {
+    size_t offset = (writer->size + align - 1) & ~(align - 1);
+
+    json_buf_reserve(
+        &json_default_allocator,
+        &writer->buf,
+        &writer->cap,
+        offset + size
+    );
+    memset(writer->buf + writer->size, 0, offset + size - writer->size);
+    writer->size = offset + size;
+
+    return offset;
+}
+
+// stores target as a pointer-sized offset from base, base being the start of
+// the block holding the pointer
+static void json_image_pointer(
+    json_image_writer_t *writer, size_t offset, size_t target, size_t base
+) {
+    uintptr_t ptr = target - base;
+
+    memcpy(writer->buf + offset, &ptr, sizeof(ptr));
+}
+
+static size_t json_image_string(
+    json_image_writer_t *writer, const char *str, size_t len
+) {
+    size_t offset = json_image_reserve(writer, len + 1, 1);
+
+    memcpy(writer->buf + offset, str, len);
+
+    return offset;
+}
+
+// the object at offset gets the same fields as object. containers are laid
+// out the way json_vec_alloc() and json_hmap_alloc() lay them out, with their
+// children stored in the same block and their own blocks after it. the data
+// of strings and containers is stored in data.integer as an offset from base.
+// children aren't written, for containers this returns true with the offsets
+// of the block and of the children's objects within it
+static bool json_image_shallow(
+    json_image_writer_t *writer, size_t offset, json_object_t *object,
+    size_t base, size_t *out_block, size_t *out_values
+) {
+    json_object_t copy = *json_force(object);
+
+    copy.is_lazy = false;
+
+    switch (object->type) {
+    case JSON_OBJECT:
+    case JSON_ARRAY:
+        copy.is_lazy = copy.is_image = true;
+        break;
+    case JSON_STRING:
+        copy.data.integer = (int64_t)(json_image_string(
+            writer,
+            object->data.string,
+            strlen(object->data.string)
+        ) - base);
+        memcpy(writer->buf + offset, &copy, sizeof(copy));
+
+        return false;
+    default:
+        memcpy(writer->buf + offset, &copy, sizeof(copy));
+
+        return false;
+    }
+
+    if (object->type == JSON_ARRAY) {
+        json_vec_t *vec = object->data.vec;
+        size_t size = vec->size;
+        size_t vec_size = JSON_ALIGN(sizeof(json_vec_t));
+        size_t values_size = size * sizeof(json_object_t);
+        size_t block = json_image_reserve(
+            writer,
+            vec_size + values_size + size * sizeof(void *),
+            JSON_PAGE_ALIGN
+        );
+        size_t values = block + vec_size;
+        size_t pointers = values + values_size;
+
+        copy.data.integer = (int64_t)(block - base);
+        memcpy(writer->buf + offset, &copy, sizeof(copy));
+
+        json_image_pointer(
+            writer,
+            block + offsetof(json_vec_t, data),
+            pointers,
+            block
+        );
+        memcpy(
+            writer->buf + block + offsetof(json_vec_t, size),
+            &size,
+            sizeof(size)
+        );
+
+        for (size_t i = 0; i < size; ++i) {
+            json_image_pointer(
+                writer,
+                pointers + i * sizeof(void *),
+                values + i * sizeof(json_object_t),
+                block
+            );
+        }
+
+        *out_block = block;
+        *out_values = values;
+
+        return true;
+    }
+
+    // entries are stored at their exact size, and the index as it is
+    json_hmap_t *hmap = object->data.hmap;
+    json_hmap_t header = *hmap;
+    size_t size = hmap->size;
+    size_t hmap_size = JSON_ALIGN(sizeof(json_hmap_t));
+    size_t values_size = size * sizeof(json_object_t);
+    size_t entries_size = size * JSON_HMAP_ENTRY_SIZE;
+    size_t slots_size = hmap->slots ? hmap->slot_cap * sizeof(json_hslot_t) : 0;
+    size_t block = json_image_reserve(
+        writer,
+        hmap_size + values_size + entries_size + slots_size,
+        JSON_PAGE_ALIGN
+    );
+    size_t values = block + hmap_size;
+    size_t entries = values + values_size;
+    size_t lens = entries + size * sizeof(json_hash_t);
+    size_t keys = lens + size * sizeof(size_t);
+    size_t objects = keys + size * sizeof(char *);
+    size_t slots = entries + entries_size;
+
+    copy.data.integer = (int64_t)(block - base);
+    memcpy(writer->buf + offset, &copy, sizeof(copy));
+
+    header.cap = size;
+    header.entries_tracked = header.slots_tracked = false;
+    header.slots = NULL;
+    memcpy(writer->buf + block, &header, sizeof(header));
+
+    json_image_pointer(
+        writer, block + offsetof(json_hmap_t, hashes), entries, block
+    );
+    json_image_pointer(writer, block + offsetof(json_hmap_t, lens), lens, block);
+    json_image_pointer(writer, block + offsetof(json_hmap_t, keys), keys, block);
+    json_image_pointer(
+        writer, block + offsetof(json_hmap_t, objects), objects, block
+    );
+
+    // an offset of 0 would point at the header, so it stands in for NULL
+    if (hmap->slots) {
+        json_image_pointer(
+            writer, block + offsetof(json_hmap_t, slots), slots, block
+        );
+        memcpy(writer->buf + slots, hmap->slots, slots_size);
+    }
+
+    memcpy(writer->buf + entries, hmap->hashes, size * sizeof(json_hash_t));
+    memcpy(writer->buf + lens, hmap->lens, size * sizeof(size_t));
+
+    for (size_t i = 0; i < size; ++i) {
+        json_image_pointer(
+            writer,
+            keys + i * sizeof(char *),
+            json_image_string(writer, hmap->keys[i], hmap->lens[i]),
+            block
+        );
+        json_image_pointer(
+            writer,
+            objects + i * sizeof(json_object_t *),
+            values + i * sizeof(json_object_t),
+            block
+        );
+    }
+
+    *out_block = block;
+    *out_values = values;
+
+    return true;
+}
+
+// container being written, and the index of its next child
+typedef struct json_image_frame {
+    json_object_t *object;
+    size_t block, values, index;
+} json_image_frame_t;
+
+// writes object and everything under it at offset, depth first with open
+// containers on a heap stack rather than by recursing
+static void json_image_object(
+    json_image_writer_t *writer, size_t offset, json_object_t *object,
+    size_t base
+) {
+    char *stack = NULL;
+    size_t stack_cap = 0, depth = 0;
+
+    while (object) {
+        size_t block, values;
+
+        if (json_image_shallow(writer, offset, object, base, &block, &values)) {
+            if (depth == JSON_MAX_DEPTH)
+                JSON_ERROR("imaged json nested deeper than JSON_MAX_DEPTH.\n");
+
+            json_buf_reserve(
+                &json_default_allocator,
+                &stack,
+                &stack_cap,
+                (depth + 1) * sizeof(json_image_frame_t)
+            );
+
+            json_image_frame_t *frame = (json_image_frame_t *)stack + depth++;
+
+            frame->object = object;
+            frame->block = block;
+            frame->values = values;
+            frame->index = 0;
+        }
+
+        // find the next child to write, leaving every finished container
+        object = NULL;
+
+        while (!object && depth) {
+            json_image_frame_t *frame = (json_image_frame_t *)stack + depth - 1;
+            json_object_t *container = frame->object;
+            size_t size = container->type == JSON_OBJECT
+                ? container->data.hmap->size
+                : container->data.vec->size;
+
+            if (frame->index == size) {
+                --depth;
+                continue;
+            }
+
+            size_t i = frame->index++;
+
+            offset = frame->values + i * sizeof(json_object_t);
+            base = frame->block;
+            object = container->type == JSON_OBJECT
+                ? container->data.hmap->objects[i]
+                : (json_object_t *)container->data.vec->data[i];
+        }
+    }
+
+    if (stack)
+        json_release(&json_default_allocator, stack, stack_cap);
+}
+
+// points an image object's data at base + its stored offset
+static void json_image_place(json_object_t *object, char *base) {
+    switch (object->type) {
+    case JSON_OBJECT:
+        object->data.hmap = (json_hmap_t *)(base + object->data.integer);
+        break;
+    case JSON_ARRAY:
+        object->data.vec = (json_vec_t *)(base + object->data.integer);
+        break;
+    case JSON_STRING:
+        object->data.string = base + object->data.integer;
+        break;
+    default:
+        break;
+    }
+}
+
+static inline void *json_image_fixup(char *block, void *ptr) {
+    return ptr ? block + (uintptr_t)ptr : NULL;
+}
+
+// fixes up one container's block, its child containers stay lazy
+static void json_force_image(json_object_t *object) {
+    char *block = (char *)object->data.vec;
+
+    if (object->type == JSON_ARRAY) {
+        json_vec_t *vec = object->data.vec;
+
+        vec->data = (void **)json_image_fixup(block, vec->data);
+
+        for (size_t i = 0; i < vec->size; ++i) {
+            vec->data[i] = json_image_fixup(block, vec->data[i]);
+            json_image_place((json_object_t *)vec->data[i], block);
+        }
+    } else {
+        json_hmap_t *hmap = object->data.hmap;
+
+        hmap->hashes = (json_hash_t *)json_image_fixup(block, hmap->hashes);
+        hmap->lens = (size_t *)json_image_fixup(block, hmap->lens);
+        hmap->keys = (char **)json_image_fixup(block, hmap->keys);
+        hmap->objects =
+            (json_object_t **)json_image_fixup(block, hmap->objects);
+        hmap->slots = (json_hslot_t *)json_image_fixup(block, hmap->slots);
+
+        for (size_t i = 0; i < hmap->size; ++i) {
+            hmap->keys[i] = (char *)json_image_fixup(block, hmap->keys[i]);
+            hmap->objects[i] =
+                (json_object_t *)json_image_fixup(block, hmap->objects[i]);
+            json_image_place(hmap->objects[i], block);
+        }
+    }
+
+    object->is_lazy = object->is_image = false;
+}
+
+char *json_image_make(json_object_t *root, size_t *out_len) {
+    json_image_writer_t writer = {NULL, 0, 0};
+    json_image_header_t header = json_image_layout();
+    size_t header_offset = json_image_reserve(&writer, sizeof(header), 1);
+
+    if (root) {
+        header.root = json_image_reserve(
+            &writer,
+            sizeof(json_object_t),
+            JSON_PAGE_ALIGN
+        );
+        json_image_object(&writer, header.root, root, 0);
+    }
+
+    header.size = writer.size;
+    memcpy(writer.buf + header_offset, &header, sizeof(header));
+
+    if (out_len)
+        *out_len = writer.size;
+
+    // hand back an exact size buffer
+    return (char *)json_resize(
+        &json_default_allocator,
+        writer.buf,
+        writer.cap,
+        writer.size
+    );
+}
+
+bool json_image_save(json_object_t *root, const json_sink_t *sink) {
+    size_t len;
+    char *image = json_image_make(root, &len);
+    bool written = sink->write(sink->user, image, len);
+
+    JSON_FREE(image);
+
+    return written;
+}
+
+void json_image_load(json_t *json, char *image, size_t len) {
+    json_image_header_t layout = json_image_layout(), header;
+
+    JSON_ASSERT(
+        !((uintptr_t)image % JSON_PAGE_ALIGN),
+        "json images must be aligned to %d bytes.\n", JSON_PAGE_ALIGN
+    );
+
+    if (len < sizeof(header))
+        JSON_ERROR("not a json image.\n");
+
+    memcpy(&header, image, sizeof(header));
+
+    if (memcmp(header.magic, layout.magic, sizeof(header.magic))
+     || header.version != layout.version)
+        JSON_ERROR("not a json image of version %d.\n", JSON_IMAGE_VERSION);
+
+    if (header.byte_order != layout.byte_order
+     || header.pointer_size != layout.pointer_size
+     || header.hash_size != layout.hash_size
+     || header.object_size != layout.object_size
+     || header.hmap_size != layout.hmap_size)
+        JSON_ERROR("json image was saved on an incompatible machine.\n");
+
+    if (header.size != len
+     || (header.root && header.root > len - sizeof(json_object_t)))
+        JSON_ERROR("json image is truncated or corrupt.\n");
+
+    json_load_empty(json);
+
+    if (header.root) {
+        json->root = (json_object_t *)(image + header.root);
+        json_image_place(json->root, image);
+    } else {
+        json->root = NULL;
+    }
+}
+
+void json_image_load_file(json_t *json, const char *filepath) {
+    char *image;
+    size_t len;
+    bool mapped = json_open_file(filepath, true, &image, &len);
+
+    json_image_load(json, image, len);
+
+    json->file_text = image;
+    json->file_len = len;
+    json->file_mapped = mapped;
+}
+
+// tapes =======================================================================
+
+#define JSON_TAPE_WORD(tag, payload)\
+    (((uint64_t)(unsigned char)(tag) << 56) | (uint64_t)(payload))
+
+// returns space for count words pushed on the end of the tape
+static inline uint64_t *json_tape_push(json_tape_t *tape, size_t count) {
+    if (tape->size + count > tape->cap) {
+        char *buf = (char *)tape->words;
+        size_t cap = tape->cap * sizeof(uint64_t);
+
+        json_buf_reserve(
+            &json_default_allocator,
+            &buf,
+            &cap,
+            (tape->size + count) * sizeof(uint64_t)
+        );
+
+        tape->words = (uint64_t *)buf;
+        tape->cap = cap / sizeof(uint64_t);
+    }
+
+    uint64_t *words = tape->words + tape->size;
+
+    tape->size += count;
+
+    return words;
+}
+
+static inline size_t json_tape_string_len(const char *str) {
+    uint64_t len;
+
+    memcpy(&len, str - sizeof(len), sizeof(len));
+
+    return (size_t)len;
+}
+
+static inline void json_tape_push_number(
+    json_tape_t *tape, const json_object_t *number
+) {
+    uint64_t *words = json_tape_push(tape, 2);
 
-    json_put(json, object, key, child);
+    words[0] = JSON_TAPE_WORD(number->is_int ? 'l' : 'd', 0);
 
-    return child;
+    if (number->is_int)
+        memcpy(&words[1], &number->data.integer, sizeof(uint64_t));
+    else
+        memcpy(&words[1], &number->data.number, sizeof(uint64_t));
 }
 
-void json_put_array(
-    json_t *json, json_object_t *object, char *key,
-    json_object_t **objects, size_t size
-) {
-    json_put(json, object, key, json_new_array(json, objects, size));
+// the strings buffer is the scratch stack of ctx, so strings are decoded right
+// where they're kept, after space for their length
+static void json_tape_expect_string(json_ctx_t *ctx, json_tape_t *tape) {
+    uint64_t len;
+    size_t str_len;
+
+    ctx->scratch_size += sizeof(len);
+
+    char *str = json_expect_string(ctx, &str_len, NULL);
+
+    len = str_len;
+    memcpy(str - sizeof(len), &len, sizeof(len));
+
+    *json_tape_push(tape, 1) = JSON_TAPE_WORD('"', str - ctx->scratch);
+    ctx->scratch_size += str_len + 1;
 }
 
-void json_put_string(
-    json_t *json, json_object_t *object, char *key, char *string
+static void json_tape_expect_scalar(json_ctx_t *ctx, json_tape_t *tape) {
+    json_object_t number;
+
+    switch (json_peek(ctx)) {
+    case '"':
+        json_tape_expect_string(ctx, tape);
+
+        break;
+    case 't':
+        json_expect_token(ctx, "true", 4);
+        *json_tape_push(tape, 1) = JSON_TAPE_WORD('t', 0);
+
+        break;
+    case 'f':
+        json_expect_token(ctx, "false", 5);
+        *json_tape_push(tape, 1) = JSON_TAPE_WORD('f', 0);
+
+        break;
+    case 'n':
+        json_expect_token(ctx, "null", 4);
+        *json_tape_push(tape, 1) = JSON_TAPE_WORD('n', 0);
+
+        break;
+    default:
+        if (json_is_digit(json_peek(ctx)) || json_peek(ctx) == '-') {
+            json_expect_number(ctx, &number);
+            json_tape_push_number(tape, &number);
+
+            break;
+        }
+
+        JSON_CTX_ERROR(ctx, "unknown token, expected value.\n");
+    }
+}
+
+static void json_tape_expect_key(json_ctx_t *ctx, json_tape_t *tape) {
+    json_tape_expect_string(ctx, tape);
+    json_next_token(ctx);
+    json_expect_token(ctx, ":", 1);
+    json_next_token(ctx);
+}
+
+// writes the container at ctx->index to the tape in a loop rather than
+// recursively. each open container's open word index and child count so far
+// are kept on a heap stack while its children are written
+static void json_tape_expect_container(json_ctx_t *ctx, json_tape_t *tape) {
+    char *stack = NULL;
+    size_t stack_cap = 0, depth = 0;
+    size_t open = 0, count = 0;
+
+    do {
+        char ch = json_peek(ctx);
+
+        if (ch == '{' || ch == '[') {
+            if (depth == JSON_MAX_DEPTH) {
+                JSON_CTX_ERROR_CODE(
+                    ctx,
+                    JSON_ERR_DEPTH,
+                    "json nested deeper than JSON_MAX_DEPTH.\n"
+                );
+            }
+
+            if (depth) {
+                json_buf_reserve(
+                    &json_default_allocator,
+                    &stack,
+                    &stack_cap,
+                    depth * 2 * sizeof(size_t)
+                );
+
+                size_t *saved = (size_t *)stack + (depth - 1) * 2;
+
+                saved[0] = open;
+                saved[1] = count;
+            }
+
+            open = tape->size;
+            count = 0;
+            ++depth;
+
+            // the payload is filled in once the container closes
+            *json_tape_push(tape, 1) = JSON_TAPE_WORD(ch, 0);
+
+            ++ctx->index;
+            json_next_token(ctx);
+
+            if (json_peek(ctx) != (ch == '{' ? '}' : ']')) {
+                if (ch == '{')
+                    json_tape_expect_key(ctx, tape);
+
+                continue;
+            }
+        } else {
+            json_tape_expect_scalar(ctx, tape);
+            ++count;
+        }
+
+        // close every container ending here
+        while (depth) {
+            char tag = JSON_TAPE_TAG(tape->words[open]);
+            char close = tag == '{' ? '}' : ']';
+
+            json_next_token(ctx);
+
+            if (json_peek(ctx) == close) {
+                ++ctx->index;
+
+                *json_tape_push(tape, 1) = JSON_TAPE_WORD(close, count);
+                tape->words[open] = JSON_TAPE_WORD(tag, tape->size);
+
+                if (--depth) {
+                    size_t *saved = (size_t *)stack + (depth - 1) * 2;
+
+                    open = saved[0];
+                    count = saved[1] + 1;
+                }
+
+                continue;
+            }
+
+            json_expect_token(ctx, ",", 1);
+            json_next_token(ctx);
+
+            if (tag == '{')
+                json_tape_expect_key(ctx, tape);
+
+            break;
+        }
+    } while (depth);
+
+    if (stack)
+        json_release(&json_default_allocator, stack, stack_cap);
+}
+
+void json_tape_load(json_tape_t *tape, const char *text, size_t len) {
+    json_ctx_t ctx;
+
+    memset(tape, 0, sizeof(*tape));
+    json_ctx_make_bare(&ctx, text, len);
+
+    json_next_token(&ctx);
+
+    if (ctx.index != ctx.len) {
+        if (json_peek(&ctx) != '{' && json_peek(&ctx) != '[')
+            JSON_CTX_ERROR(&ctx, "invalid json root.\n");
+
+        json_tape_expect_container(&ctx, tape);
+
+        // only whitespace may follow the root
+        json_next_token(&ctx);
+
+        if (ctx.index != ctx.len)
+            JSON_CTX_ERROR(&ctx, "unexpected text after json root.\n");
+    }
+
+    tape->strings = ctx.scratch;
+    tape->strings_size = ctx.scratch_size;
+    tape->strings_cap = ctx.scratch_cap;
+}
+
+static void json_tape_flatten_string(
+    json_tape_t *tape, const char *str, size_t str_len
 ) {
-    json_put(json, object, key, json_new_string(json, string));
+    uint64_t len = str_len;
+
+    json_buf_reserve(
+        &json_default_allocator,
+        &tape->strings,
+        &tape->strings_cap,
+        tape->strings_size + sizeof(len) + str_len + 1
+    );
+
+    char *dst = tape->strings + tape->strings_size + sizeof(len);
+
+    memcpy(dst - sizeof(len), &len, sizeof(len));
+    memcpy(dst, str, str_len);
+    dst[str_len] = '\0';
+
+    *json_tape_push(tape, 1) = JSON_TAPE_WORD('"', dst - tape->strings);
+    tape->strings_size += sizeof(len) + str_len + 1;
 }
 
-void json_put_number(
-    json_t *json, json_object_t *object, char *key, double number
+// container being flattened, where its open word is, and its next child
+typedef struct json_tape_frame {
+    json_object_t *object;
+    size_t open, index;
+} json_tape_frame_t;
+
+// pushes a scalar, or the open word of a container leaving it to be filled in
+// by json_tape_flatten(). returns whether object was a container
+static bool json_tape_flatten_shallow(
+    json_tape_t *tape, json_object_t *object
 ) {
-    json_put(json, object, key, json_new_number(json, number));
+    switch (object->type) {
+    case JSON_OBJECT:
+    case JSON_ARRAY:
+        json_tape_push(tape, 1);
+        json_force(object);
+
+        return true;
+    case JSON_STRING:
+        json_tape_flatten_string(
+            tape,
+            object->data.string,
+            strlen(object->data.string)
+        );
+
+        break;
+    case JSON_NUMBER:
+        json_tape_push_number(tape, object);
+
+        break;
+    case JSON_TRUE:
+        *json_tape_push(tape, 1) = JSON_TAPE_WORD('t', 0);
+
+        break;
+    case JSON_FALSE:
+        *json_tape_push(tape, 1) = JSON_TAPE_WORD('f', 0);
+
+        break;
+    case JSON_NULL:
+        *json_tape_push(tape, 1) = JSON_TAPE_WORD('n', 0);
+
+        break;
+    }
+
+    return false;
 }
 
-void json_put_bool(json_t *json, json_object_t *object, char *key, bool value) {
-    json_put(json, object, key, json_new_bool(json, value));
+// depth first with open containers on a heap stack rather than by recursing
+static void json_tape_flatten(json_tape_t *tape, json_object_t *object) {
+    char *stack = NULL;
+    size_t stack_cap = 0, depth = 0;
+
+    while (object) {
+        size_t open = tape->size;
+
+        if (json_tape_flatten_shallow(tape, object)) {
+            if (depth == JSON_MAX_DEPTH)
+                JSON_ERROR("taped json nested deeper than JSON_MAX_DEPTH.\n");
+
+            json_buf_reserve(
+                &json_default_allocator,
+                &stack,
+                &stack_cap,
+                (depth + 1) * sizeof(json_tape_frame_t)
+            );
+
+            json_tape_frame_t *frame = (json_tape_frame_t *)stack + depth++;
+
+            frame->object = object;
+            frame->open = open;
+            frame->index = 0;
+        }
+
+        // find the next child, closing every finished container
+        object = NULL;
+
+        while (!object && depth) {
+            json_tape_frame_t *frame = (json_tape_frame_t *)stack + depth - 1;
+            json_object_t *container = frame->object;
+            bool is_obj = container->type == JSON_OBJECT;
+            size_t count = is_obj
+                ? container->data.hmap->size
+                : container->data.vec->size;
+
+            if (frame->index == count) {
+                *json_tape_push(tape, 1) =
+                    JSON_TAPE_WORD(is_obj ? '}' : ']', count);
+                tape->words[frame->open] =
+                    JSON_TAPE_WORD(is_obj ? '{' : '[', tape->size);
+                --depth;
+
+                continue;
+            }
+
+            size_t i = frame->index++;
+
+            if (is_obj) {
+                json_hmap_t *hmap = container->data.hmap;
+
+                json_tape_flatten_string(tape, hmap->keys[i], hmap->lens[i]);
+                object = hmap->objects[i];
+            } else {
+                object = (json_object_t *)container->data.vec->data[i];
+            }
+        }
+    }
+
+    if (stack)
+        json_release(&json_default_allocator, stack, stack_cap);
 }
 
-void json_put_null(json_t *json, json_object_t *object, char *key) {
-    json_put(json, object, key, json_new_null(json));
+void json_tape_make(json_tape_t *tape, json_object_t *root) {
+    memset(tape, 0, sizeof(*tape));
+
+    if (root)
+        json_tape_flatten(tape, root);
+}
+
+void json_tape_free(json_tape_t *tape) {
+    if (tape->words) {
+        json_release(
+            &json_default_allocator,
+            tape->words,
+            tape->cap * sizeof(uint64_t)
+        );
+    }
+
+    if (tape->strings)
+        json_release(&json_default_allocator, tape->strings, tape->strings_cap);
+
+    memset(tape, 0, sizeof(*tape));
+}
+
+// returns the index of the word after the value at index
+static inline size_t json_tape_skip(const uint64_t *words, size_t index) {
+    uint64_t word = words[index];
+
+    switch (JSON_TAPE_TAG(word)) {
+    case '{':
+    case '[':
+        return (size_t)JSON_TAPE_PAYLOAD(word);
+    case 'l':
+    case 'd':
+        return index + 2;
+    default:
+        return index + 1;
+    }
+}
+
+static inline char json_tape_tag(json_tape_value_t value) {
+    return JSON_TAPE_TAG(value.tape->words[value.index]);
+}
+
+#define JSON_ASSERT_TAPE_TYPE(json_type)\
+    JSON_ASSERT(\
+        json_tape_type(value) == json_type,\
+        "attempted to cast %s to %s.\n",\
+        json_types[json_tape_type(value)], json_types[json_type]\
+    )
+
+json_tape_value_t json_tape_root(const json_tape_t *tape) {
+    json_tape_value_t value;
+
+    JSON_ASSERT(tape->size, "attempted to get the root of an empty tape.\n");
+
+    value.tape = tape;
+    value.index = 0;
+
+    return value;
+}
+
+json_type_e json_tape_type(json_tape_value_t value) {
+    switch (json_tape_tag(value)) {
+    case '{':
+        return JSON_OBJECT;
+    case '[':
+        return JSON_ARRAY;
+    case '"':
+        return JSON_STRING;
+    case 'l':
+    case 'd':
+        return JSON_NUMBER;
+    case 't':
+        return JSON_TRUE;
+    case 'f':
+        return JSON_FALSE;
+    default:
+        return JSON_NULL;
+    }
+}
+
+bool json_tape_is_int(json_tape_value_t value) {
+    return json_tape_tag(value) == 'l';
+}
+
+size_t json_tape_size(json_tape_value_t value) {
+    const uint64_t *words = value.tape->words;
+
+    JSON_ASSERT(
+        json_tape_tag(value) == '{' || json_tape_tag(value) == '[',
+        "attempted to get the size of a %s.\n",
+        json_types[json_tape_type(value)]
+    );
+
+    return (size_t)JSON_TAPE_PAYLOAD(
+        words[JSON_TAPE_PAYLOAD(words[value.index]) - 1]
+    );
+}
+
+const char *json_tape_string(json_tape_value_t value, size_t *out_len) {
+    uint64_t word = value.tape->words[value.index];
+    const char *str = value.tape->strings + JSON_TAPE_PAYLOAD(word);
+
+    JSON_ASSERT_TAPE_TYPE(JSON_STRING);
+
+    if (out_len)
+        *out_len = json_tape_string_len(str);
+
+    return str;
+}
+
+double json_tape_number(json_tape_value_t value) {
+    const uint64_t *words = value.tape->words;
+    int64_t integer;
+    double number;
+
+    JSON_ASSERT_TAPE_TYPE(JSON_NUMBER);
+
+    if (json_tape_is_int(value)) {
+        memcpy(&integer, &words[value.index + 1], sizeof(integer));
+
+        return (double)integer;
+    }
+
+    memcpy(&number, &words[value.index + 1], sizeof(number));
+
+    return number;
+}
+
+int64_t json_tape_int64(json_tape_value_t value) {
+    const uint64_t *words = value.tape->words;
+    int64_t integer;
+
+    JSON_ASSERT_TAPE_TYPE(JSON_NUMBER);
+
+    if (!json_tape_is_int(value))
+        return (int64_t)json_tape_number(value);
+
+    memcpy(&integer, &words[value.index + 1], sizeof(integer));
+
+    return integer;
+}
+
+bool json_tape_bool(json_tape_value_t value) {
+    JSON_ASSERT(
+        json_tape_tag(value) == 't' || json_tape_tag(value) == 'f',
+        "attempted to cast %s to bool.\n",
+        json_types[json_tape_type(value)]
+    );
+
+    return json_tape_tag(value) == 't';
+}
+
+json_tape_iter_t json_tape_iter(json_tape_value_t value) {
+    json_tape_iter_t iter;
+
+    JSON_ASSERT(
+        json_tape_tag(value) == '{' || json_tape_tag(value) == '[',
+        "attempted to iterate over a %s.\n",
+        json_types[json_tape_type(value)]
+    );
+
+    iter.tape = value.tape;
+    iter.index = value.index + 1;
+    iter.end = (size_t)JSON_TAPE_PAYLOAD(value.tape->words[value.index]) - 1;
+    iter.object = json_tape_tag(value) == '{';
+    iter.key = NULL;
+
+    return iter;
+}
+
+bool json_tape_next(json_tape_iter_t *iter, json_tape_value_t *out) {
+    const uint64_t *words = iter->tape->words;
+
+    if (iter->index == iter->end)
+        return false;
+
+    if (iter->object) {
+        iter->key = iter->tape->strings + JSON_TAPE_PAYLOAD(words[iter->index]);
+        ++iter->index;
+    }
+
+    out->tape = iter->tape;
+    out->index = iter->index;
+    iter->index = json_tape_skip(words, iter->index);
+
+    return true;
+}
+
+bool json_tape_get(
+    json_tape_value_t value, const char *key, json_tape_value_t *out
+) {
+    JSON_ASSERT(
+        json_tape_tag(value) == '{',
+        "attempted to get child \"%s\" from a non-object.\n",
+        key
+    );
+
+    json_tape_iter_t iter = json_tape_iter(value);
+    json_tape_value_t child;
+    size_t len = strlen(key);
+    bool found = false;
+
+    // the whole object is scanned so the last duplicate wins, like json_put()
+    while (json_tape_next(&iter, &child)) {
+        if (json_tape_string_len(iter.key) == len
+         && !memcmp(iter.key, key, len)) {
+            *out = child;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+bool json_tape_at(json_tape_value_t value, size_t index, json_tape_value_t *out) {
+    JSON_ASSERT(
+        json_tape_tag(value) == '[',
+        "attempted to index a %s.\n",
+        json_types[json_tape_type(value)]
+    );
+
+    json_tape_iter_t iter = json_tape_iter(value);
+
+    while (json_tape_next(&iter, out))
+        if (!index--)
+            return true;
+
+    return false;
 }
 
 #endif // GHH_JSON_IMPL
 
 #ifdef __cplusplus
 }
+
+// hashes a string literal at compile time, c++11 constexpr has to recurse
+constexpr json_hash_t json_hash_literal(
+    const char *str, size_t len, json_hash_t hash
+) {
+    return len ? json_hash_literal(
+        str + 1,
+        len - 1,
+        (hash ^ (unsigned char)*str) * (json_hash_t)JSON_FNV_PRIME
+    ) : hash;
+}
+
+// constexpr json_key_t name = json_key("name");
+template <size_t N>
+constexpr json_key_t json_key(const char (&str)[N]) {
+    return json_key_t{
+        str,
+        N - 1,
+        json_hash_literal(str, N - 1, (json_hash_t)JSON_FNV_BASIS)
+    };
+}
 #endif
 
 #endif // GHH_JSON_H